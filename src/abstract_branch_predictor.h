@@ -7,6 +7,7 @@
 #ifndef __ABSTRACT_BRANCH_PREDICTOR_H__
 #define __ABSTRACT_BRANCH_PREDICTOR_H__
 #include <cstdint>
+#include "checkpoint.h"
 
 /*
  * AbstractBranchPredictor should be Inherited by your
@@ -29,6 +30,10 @@ public:
 	virtual void update(uint32_t PC, bool taken, uint32_t target) = 0;
 
 	virtual bool checkMisprediction(uint32_t PC, bool taken) = 0;
+
+	//save and restore the predictor tables (none by default)
+	virtual void serialize(CheckpointOut& cp) {}
+	virtual void unserialize(CheckpointIn& cp) {}
 };
 
 #endif
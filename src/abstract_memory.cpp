@@ -4,10 +4,14 @@
  * PSU
  */
 
+#include <cassert>
 #include "abstract_memory.h"
 
-AbstractMemory::AbstractMemory(uint32_t delay, uint32_t reqQueueCapacity) :
-		accessDelay(delay), reqQueueCapacity(reqQueueCapacity) {
+AbstractMemory::AbstractMemory(SimContext* ctx, uint32_t delay,
+		uint32_t reqQueueCapacity) :
+		BaseObject(ctx), eventQueue(nullptr), eventPriority(0), pendingReqs(0),
+		reqQueueCapacity(reqQueueCapacity), accessDelay(delay) {
+	assert(reqQueueCapacity > 0 && "Request queue size must be at least 1");
 
 }
 
@@ -15,3 +19,11 @@ AbstractMemory::~AbstractMemory() {
 	// TODO Auto-generated destructor stub
 }
 
+
+bool AbstractMemory::scheduleReq(Packet* pkt) {
+	if (pendingReqs >= reqQueueCapacity)
+		return false;
+	pendingReqs++;
+	eventQueue->schedule(this, pkt);
+	return true;
+}
@@ -7,9 +7,9 @@
 #ifndef __ABSTRACT_MEMORY_H__
 #define __ABSTRACT_MEMORY_H__
 #include<cstdint>
-#include <queue>
 #include "util.h"
 #include "base_object.h"
+#include "event_queue.h"
 
 
 /*
@@ -17,23 +17,36 @@
  */
 class AbstractMemory : public BaseObject {
 public:
-	AbstractMemory(uint32_t delay, uint32_t reqQueueCapacity);
+	AbstractMemory(SimContext* ctx, uint32_t delay, uint32_t reqQueueCapacity);
 	virtual ~AbstractMemory();
 	/*
-	 * invoked each cycle for this memory object
-	 * to service and respond the packets that are
-	 * ready to be serviced
+	 * invoked by the event queue when a packet that this memory
+	 * object scheduled becomes ready to be serviced and responded
 	 */
-	virtual void Tick() = 0;
+	virtual void serviceReq(Packet* pkt) = 0;
 
 	//send a request to this memory object
 	virtual bool sendReq(Packet * pkt) = 0;
 
 	//this memory object has received a packet
 	virtual void recvResp(Packet* readRespPkt) = 0;
-	//request queue for incoming requests
-	std::queue<Packet*> reqQueue;
-	//max capacity of request queue
+
+	/*
+	 * schedule pkt to be serviced by this memory object at
+	 * pkt->ready_time. Returns false if the request queue is full
+	 */
+	bool scheduleReq(Packet* pkt);
+
+	//simulator-wide event queue, set by EventQueue::addObject
+	EventQueue* eventQueue;
+	//order of this object among those serviced in the same cycle
+	uint32_t eventPriority;
+	//number of scheduled packets that are not serviced yet
+	uint32_t pendingReqs;
+	/*
+	 * max number of pending requests (req_queue_size_* in the config),
+	 * once reached sendReq rejects requests and the sender retries
+	 */
 	uint32_t reqQueueCapacity;
 
 	/*
@@ -62,6 +75,27 @@ public:
 	 * the portion of memory that has been modified
 	 */
 	virtual void dumpRead(uint32_t addr, uint32_t size, uint8_t* data) = 0;
+	/*
+	 * like dumpRead, but for any range: each block is looked up once
+	 * and the blocks that miss are read from the next level in runs.
+	 * The caches are write-through, so the L1D and the L2 are enough
+	 * to find the newest copy
+	 */
+	virtual void dumpReadRange(uint32_t addr, uint32_t len, uint8_t* buf) = 0;
+
+	/*
+	 * write a portion of memory without any timing, updating the
+	 * copy in this memory object and in all the next levels. Used
+	 * by the functional simulation to keep the caches coherent
+	 */
+	virtual void dumpWrite(uint32_t addr, uint32_t size, uint8_t* data) = 0;
+
+	/*
+	 * functional warming: bring the block of a load or fetch into
+	 * this memory object (and the next levels) with the same state
+	 * changes a timed access would make, but without any timing
+	 */
+	virtual void warmAccess(uint32_t addr, PacketSrcType type) = 0;
 };
 
 #endif
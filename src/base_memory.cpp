@@ -8,27 +8,84 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "base_memory.h"
+#include "cache.h"
 #include "util.h"
 
-BaseMemory::BaseMemory(uint32_t memDelay) :
-		AbstractMemory(memDelay, 100) {
-	//memory will be dynamically allocated at initialization
-	MEM_REGIONS[0] = {MEM_TEXT_START, MEM_TEXT_SIZE, nullptr};
-	MEM_REGIONS[1] = {MEM_DATA_START, MEM_DATA_SIZE, nullptr};
-	MEM_REGIONS[2] = {MEM_STACK_START, MEM_STACK_SIZE, nullptr};
-	MEM_REGIONS[3] = {MEM_KDATA_START, MEM_KDATA_SIZE, nullptr};
-	MEM_REGIONS[4] = {MEM_KTEXT_START, MEM_KTEXT_SIZE, nullptr};
-
-	for (int i = 0; i < MEM_NREGIONS; i++) {
-		MEM_REGIONS[i].mem = (uint8_t *)malloc(MEM_REGIONS[i].size);
-		memset(MEM_REGIONS[i].mem, 0, MEM_REGIONS[i].size);
-	}
+//number of pages allocated at once
+#define MEM_PAGE_CHUNK 16
+
+BaseMemory::BaseMemory(SimContext* ctx, uint32_t memDelay,
+		uint32_t reqQueueCapacity) :
+		AbstractMemory(ctx, memDelay, reqQueueCapacity), numPages(0),
+		nextPage(nullptr), numFreePages(0) {
+	//anonymous mappings are zero-filled, like the mapped checkpoints
+	void* mem = mmap(nullptr, MEM_PAGE_SIZE, PROT_READ,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	assert(mem != MAP_FAILED && "Could not allocate the zero page");
+	zeroPage = (uint8_t *) mem;
+
+	//the tables are allocated on the first write to them
+	zeroTable = new mem_page_table_t();
+	for (uint32_t i = 0; i < MEM_TABLE_SIZE; i++)
+		zeroTable->pages[i] = zeroPage;
+	for (uint32_t i = 0; i < MEM_DIR_SIZE; i++)
+		pageDir[i] = zeroTable;
 }
 
 BaseMemory::~BaseMemory() {
-	for (int i = 0; i < MEM_NREGIONS; i++)
-		free(MEM_REGIONS[i].mem);
+	for (uint32_t i = 0; i < mappings.size(); i++)
+		munmap(mappings[i].mem, mappings[i].size);
+	for (uint32_t i = 0; i < MEM_DIR_SIZE; i++) {
+		if (pageDir[i] != zeroTable)
+			delete pageDir[i];
+	}
+	delete zeroTable;
+	munmap(zeroPage, MEM_PAGE_SIZE);
+}
+
+mem_page_table_t* BaseMemory::getTable(uint32_t addr) {
+	mem_page_table_t*& table = pageDir[addr >> MEM_DIR_SHIFT];
+	if (table == zeroTable)
+		table = new mem_page_table_t(*zeroTable);
+	return table;
+}
+
+uint8_t* BaseMemory::allocPage(uint32_t addr) {
+	if (numFreePages == 0) {
+		uint64_t size = (uint64_t) MEM_PAGE_SIZE * MEM_PAGE_CHUNK;
+		void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		assert(mem != MAP_FAILED && "Could not allocate memory pages");
+		mappings.push_back({(uint8_t *) mem, size});
+		nextPage = (uint8_t *) mem;
+		numFreePages = MEM_PAGE_CHUNK;
+	}
+	uint8_t* page = nextPage;
+	nextPage += MEM_PAGE_SIZE;
+	numFreePages--;
+	numPages++;
+	getTable(addr)->pages[(addr >> MEM_PAGE_SHIFT) & (MEM_TABLE_SIZE - 1)] = page;
+	return page;
+}
+
+void BaseMemory::clearPages() {
+	for (uint32_t i = 0; i < MEM_DIR_SIZE; i++) {
+		if (pageDir[i] != zeroTable) {
+			delete pageDir[i];
+			pageDir[i] = zeroTable;
+		}
+	}
+	for (uint32_t i = 0; i < mappings.size(); i++)
+		munmap(mappings[i].mem, mappings[i].size);
+	mappings.clear();
+	nextPage = nullptr;
+	numFreePages = 0;
+	numPages = 0;
 }
 
 bool BaseMemory::sendReq(Packet * pkt) {
@@ -39,35 +96,19 @@ bool BaseMemory::sendReq(Packet * pkt) {
 	TRACE(TRACE_MEMORY, pkt->type == PacketTypeStore,
 			"mdump 0x%x 0x%x\n", pkt->addr, pkt->addr + pkt->size);
 
-	mem_region_t* mem_region = getMemRegion(pkt->addr, pkt->size);
-
-	//if the accessed memory region is valid
-	if (mem_region) {
+	//if the access is within a page
+	if (translate(pkt->addr, pkt->size, false)) {
 		//update the time to service the packet
 		pkt->ready_time += accessDelay;
 		DPRINTF(DEBUG_MEMORY, "packet is added to memory reqQueue with readyTime %d\n", pkt->ready_time);
-		//add the packet to request queue if it has free entry
-		if (reqQueue.size() < reqQueueCapacity) {
-			reqQueue.push(pkt);
-			//return true since memory received the request successfully
-			return true;
-		} else {
-			/*
-			 * return false since memory could not add the packet
-			 * to request queue, the source of packet should retry
-			 */
-			return false;
-		}
+		/*
+		 * schedule the packet if the request queue has a free entry,
+		 * o.w. return false and the source of packet should retry
+		 */
+		return scheduleReq(pkt);
 
 	} else {
-		//access to invalid region of memory
-		for (int i = 0; i < MEM_NREGIONS; i++) {
-			std::cerr << "MemoryRegion #" << i << " : " << std::hex
-					<< MEM_REGIONS[i].start << " "
-					<< MEM_REGIONS[i].start + MEM_REGIONS[i].size << std::dec
-					<< "\n";
-		}
-		std::cerr << "Access to a unallocated region of memory : addr : "
+		std::cerr << "Access across a memory page : addr : "
 				<< std::hex << pkt->addr << " " << pkt->addr + pkt->size
 				<< std::dec << "\n";
 		assert(false);
@@ -79,88 +120,61 @@ void BaseMemory::recvResp(Packet* pkt) {
 	return;
 }
 
-mem_region_t*
-BaseMemory::getMemRegion(uint32_t addr, uint32_t size) {
-	for (int i = 0; i < MEM_NREGIONS; i++) {
-		if (addr >= MEM_REGIONS[i].start
-				&& (addr + size)
-						< (MEM_REGIONS[i].start + MEM_REGIONS[i].size)) {
-			return &MEM_REGIONS[i];
-		}
-	}
-	return nullptr;
-}
-
-void BaseMemory::Tick() {
-	while (!reqQueue.empty()) {
-		//check if any packet is ready to be serviced
-		if (reqQueue.front()->ready_time <= currCycle) {
-			Packet* respPkt = reqQueue.front();
-			reqQueue.pop();
-			DPRINTF(DEBUG_MEMORY,
-					"main memory send respond for pkt: addr = %x, ready_time = %d, isWrite = %d\n",
-					respPkt->addr, respPkt->ready_time, respPkt->isWrite);
-
-			if (respPkt->isWrite) {
-				mem_region_t* mem_region = getMemRegion(respPkt->addr,
-						respPkt->size);
-				int index = respPkt->addr - mem_region->start;
-				//perform the write in the memory
-				for (uint32_t i = 0; i < respPkt->size; i++) {
-					mem_region->mem[index + i] = *(respPkt->data + i);
-				}
-				//change this pkt to respond pkt
-				respPkt->isReq = false;
-				//the data part is no longer needed
-				delete respPkt->data;
-				respPkt->data = nullptr;
-				/*
-				 * send the respond to the previous base_object which is waiting
-				 * for this respond packet. For now, prev for memory is core but
-				 * you should update the prev since you are adding the caches
-				 */
-				prev->recvResp(respPkt);
-			} else {
-				mem_region_t* mem_region = getMemRegion(respPkt->addr, respPkt->size);
-				int index = respPkt->addr - mem_region->start;
-				//perform the read
-				for (uint32_t i = 0; i < respPkt->size; i++) {
-					*(respPkt->data + i) = mem_region->mem[index + i];
-				}
-				respPkt->isReq = false;
-
-				mem_region_t* mem_region_block = getMemRegion(respPkt->cacheBlockAddr, respPkt->cacheBlockSize);
-				if(mem_region_block) {
-					int index = respPkt->cacheBlockAddr - mem_region_block->start;
-
-					//perform the read
-					for (uint32_t i = 0; i < respPkt->cacheBlockSize; i++) {
-						*(respPkt->cacheBlockData + i) = mem_region_block->mem[index + i];
-					}
-
-				} else {
-					std::cerr << "Access to a unallocated region of memory : addr : "
-									<< std::hex << respPkt->cacheBlockAddr << " "
-									<< respPkt->cacheBlockAddr + respPkt->cacheBlockSize
-									<< std::dec << "\n";
-				}
-
-				/*
-				 * send the respond to the previous base_object which is waiting
-				 * for this respond packet. For now, prev for memory is core but
-				 * you should update the prev since you are adding the caches
-				 */
-				prev->recvResp(respPkt);
-			}
+//in the static hierarchy the main memory responds to the L2
+inline void BaseMemory::respondPrev(Packet* pkt) {
+	if (ctx->staticHierarchy)
+		static_cast<Cache*>(prev)->recvResp(pkt);
+	else
+		prev->recvResp(pkt);
+}
+
+void BaseMemory::serviceReq(Packet* respPkt) {
+	DPRINTF(DEBUG_MEMORY,
+			"main memory send respond for pkt: addr = %x, ready_time = %d, isWrite = %d\n",
+			respPkt->addr, respPkt->ready_time, respPkt->isWrite);
+
+	if (respPkt->isWrite) {
+		//perform the write in the memory
+		memcpy(translate(respPkt->addr, respPkt->size, true), respPkt->data,
+				respPkt->size);
+		//change this pkt to respond pkt
+		respPkt->isReq = false;
+		/*
+		 * send the respond to the previous base_object which is waiting
+		 * for this respond packet. For now, prev for memory is core but
+		 * you should update the prev since you are adding the caches
+		 */
+		respondPrev(respPkt);
+	} else {
+		//perform the read
+		memcpy(respPkt->data, translate(respPkt->addr, respPkt->size, false),
+				respPkt->size);
+		respPkt->isReq = false;
+
+		const uint8_t* block = translate(respPkt->cacheBlockAddr,
+				respPkt->cacheBlockSize, false);
+		if(respPkt->cacheBlockSize == 0) {
+			//tag-only caches ask for no block
+			respPkt->cacheBlockData = nullptr;
+		} else if(block) {
+			//the caches copy the block straight from the memory page
+			respPkt->cacheBlockData = block;
+
 		} else {
-			/*
-			 * assume that reqQueue is sorted by ready_time for now
-			 * (because the pipeline is in-order)
-			 */
-			break;
+			respPkt->cacheBlockSize = 0;
+			std::cerr << "Access across a memory page : addr : "
+							<< std::hex << respPkt->cacheBlockAddr << " "
+							<< respPkt->cacheBlockAddr + respPkt->cacheBlockSize
+							<< std::dec << "\n";
 		}
+
+		/*
+		 * send the respond to the previous base_object which is waiting
+		 * for this respond packet. For now, prev for memory is core but
+		 * you should update the prev since you are adding the caches
+		 */
+		respondPrev(respPkt);
 	}
-	return;
 }
 
 /*
@@ -170,9 +184,227 @@ void BaseMemory::Tick() {
  * function
  */
 void BaseMemory::dumpRead(uint32_t addr, uint32_t size, uint8_t* data) {
-	mem_region_t* mem_region = getMemRegion(addr, size);
-	int index = addr - mem_region->start;
-	for (uint32_t i = 0; i < size; i++) {
-		*(data + i) = mem_region->mem[index + i];
+	while (size > 0) {
+		//copy up to the end of the page
+		uint32_t chunk = MEM_PAGE_SIZE - (addr & (MEM_PAGE_SIZE - 1));
+		if (chunk > size)
+			chunk = size;
+		uint8_t* mem = translate(addr, chunk, false);
+		memcpy(data, mem, chunk);
+		addr += chunk;
+		data += chunk;
+		size -= chunk;
+	}
+}
+
+void BaseMemory::dumpWrite(uint32_t addr, uint32_t size, uint8_t* data) {
+	while (size > 0) {
+		uint32_t chunk = MEM_PAGE_SIZE - (addr & (MEM_PAGE_SIZE - 1));
+		if (chunk > size)
+			chunk = size;
+		memcpy(translate(addr, chunk, true), data, chunk);
+		addr += chunk;
+		data += chunk;
+		size -= chunk;
+	}
+}
+
+void BaseMemory::getWrittenPages(std::vector<uint32_t>& addrs) {
+	addrs.clear();
+	for (uint32_t i = 0; i < MEM_DIR_SIZE; i++) {
+		if (pageDir[i] == zeroTable)
+			continue;
+		for (uint32_t j = 0; j < MEM_TABLE_SIZE; j++) {
+			uint8_t* page = pageDir[i]->pages[j];
+			if (page != zeroPage)
+				addrs.push_back((i << MEM_DIR_SHIFT) | (j << MEM_PAGE_SHIFT));
+		}
+	}
+}
+
+void BaseMemory::serialize(CheckpointOut& cp) {
+	//addresses of the written pages, then the pages themselves
+	std::vector<uint32_t> addrs;
+	getWrittenPages(addrs);
+	uint32_t count = addrs.size();
+	cp.write(count);
+	if (count > 0)
+		cp.write(&addrs[0], (uint64_t) count * sizeof(uint32_t));
+
+	uint64_t offset = cp.alignToPage();
+	for (uint32_t i = 0; i < count; i++)
+		cp.write(translate(addrs[i], MEM_PAGE_SIZE, false), MEM_PAGE_SIZE);
+	DPRINTF(DEBUG_MEMORY, "%d memory pages saved at offset %lx\n", count,
+			offset);
+}
+
+void BaseMemory::unserialize(CheckpointIn& cp) {
+	uint32_t count;
+	cp.read(count);
+	//the page list must be in the file before it is allocated
+	if (!cp.has((uint64_t) count * sizeof(uint32_t)))
+		return;
+	std::vector<uint32_t> addrs(count);
+	if (count > 0)
+		cp.read(&addrs[0], (uint64_t) count * sizeof(uint32_t));
+	uint64_t offset = cp.alignToPage();
+	uint64_t size = (uint64_t) count * MEM_PAGE_SIZE;
+	//check the pages are in the file before mapping them
+	cp.seek(offset + size);
+	//the memory is left as it was if the checkpoint is bad
+	if (cp.failed())
+		return;
+
+	clearPages();
+	if (count == 0)
+		return;
+
+	//private mapping: writes of the simulation never reach the file
+	void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+			cp.getFd(), offset);
+	if (mem == MAP_FAILED) {
+		cp.fail("can't map the memory pages");
+		return;
+	}
+	mappings.push_back({(uint8_t *) mem, size});
+
+	for (uint32_t i = 0; i < count; i++) {
+		mem_page_table_t* table = getTable(addrs[i]);
+		uint32_t index = (addrs[i] >> MEM_PAGE_SHIFT) & (MEM_TABLE_SIZE - 1);
+		if ((addrs[i] & (MEM_PAGE_SIZE - 1)) || table->pages[index] != zeroPage) {
+			cp.fail("bad memory page address");
+			continue;
+		}
+		table->pages[index] = (uint8_t *) mem + (uint64_t) i * MEM_PAGE_SIZE;
+		numPages++;
+	}
+}
+
+//print the error of a memory image and return false
+static bool imageError(const char* filename, const char* what, int fd) {
+	std::cerr << "Error: memory image " << filename << ": " << what << "\n";
+	if (fd >= 0)
+		close(fd);
+	return false;
+}
+
+bool BaseMemory::isImage(const char* filename) {
+	char magic[8];
+	FILE* file = fopen(filename, "rb");
+	if (file == nullptr)
+		return false;
+	bool image = fread(magic, 1, 8, file) == 8
+			&& memcmp(magic, MEM_IMAGE_MAGIC, 8) == 0;
+	fclose(file);
+	return image;
+}
+
+bool BaseMemory::loadImage(const char* filename) {
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return imageError(filename, "can't open the file", -1);
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+		return imageError(filename, "can't read the file", fd);
+
+	mem_image_header_t header;
+	if (pread(fd, &header, sizeof(header), 0) != sizeof(header)
+			|| memcmp(header.magic, MEM_IMAGE_MAGIC, 8) != 0)
+		return imageError(filename, "not a memory image", fd);
+	if (header.version != MEM_IMAGE_VERSION)
+		return imageError(filename, "unsupported version", fd);
+
+	//the table must be in the file before it is allocated
+	uint64_t tableSize = (uint64_t) header.numSegments
+			* sizeof(mem_image_segment_t);
+	if (sizeof(header) + tableSize > (uint64_t) st.st_size)
+		return imageError(filename, "file is truncated", fd);
+	std::vector<mem_image_segment_t> segments(header.numSegments);
+	if (tableSize > 0
+			&& pread(fd, &segments[0], tableSize, sizeof(header))
+					!= (ssize_t) tableSize)
+		return imageError(filename, "file is truncated", fd);
+
+	//check all the segments before changing the memory
+	for (uint32_t i = 0; i < segments.size(); i++) {
+		mem_image_segment_t& seg = segments[i];
+		uint64_t size = (uint64_t) seg.numPages * MEM_PAGE_SIZE;
+		if ((seg.start & (MEM_PAGE_SIZE - 1)) || (seg.offset & (MEM_PAGE_SIZE - 1)))
+			return imageError(filename, "segment is not page-aligned", fd);
+		if (seg.offset + size > (uint64_t) st.st_size)
+			return imageError(filename, "file is truncated", fd);
+		if (seg.start + size > (1ull << 32))
+			return imageError(filename, "segment exceeds the address space", fd);
+	}
+
+	for (uint32_t i = 0; i < segments.size(); i++) {
+		mem_image_segment_t& seg = segments[i];
+		uint64_t size = (uint64_t) seg.numPages * MEM_PAGE_SIZE;
+		if (size == 0)
+			continue;
+		//private mapping: writes of the simulation never reach the file
+		void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+				fd, seg.offset);
+		if (mem == MAP_FAILED)
+			return imageError(filename, "can't map a segment", fd);
+		mappings.push_back({(uint8_t *) mem, size});
+
+		for (uint32_t j = 0; j < seg.numPages; j++) {
+			uint32_t addr = seg.start + j * MEM_PAGE_SIZE;
+			mem_page_table_t* table = getTable(addr);
+			uint32_t index = (addr >> MEM_PAGE_SHIFT) & (MEM_TABLE_SIZE - 1);
+			if (table->pages[index] == zeroPage)
+				numPages++;
+			table->pages[index] = (uint8_t *) mem + (uint64_t) j * MEM_PAGE_SIZE;
+		}
+	}
+	//the mappings stay valid without the descriptor
+	close(fd);
+	return true;
+}
+
+bool BaseMemory::saveImage(const char* filename) {
+	std::vector<uint32_t> addrs;
+	getWrittenPages(addrs);
+
+	//consecutive written pages form a segment
+	std::vector<mem_image_segment_t> segments;
+	for (uint32_t i = 0; i < addrs.size(); i++) {
+		if (!segments.empty()
+				&& (uint64_t) segments.back().start
+						+ (uint64_t) segments.back().numPages * MEM_PAGE_SIZE
+						== addrs[i])
+			segments.back().numPages++;
+		else
+			segments.push_back({addrs[i], 1, 0});
+	}
+
+	uint64_t offset = sizeof(mem_image_header_t)
+			+ segments.size() * sizeof(mem_image_segment_t);
+	for (uint32_t i = 0; i < segments.size(); i++) {
+		offset = (offset + MEM_PAGE_SIZE - 1) & ~(uint64_t) (MEM_PAGE_SIZE - 1);
+		segments[i].offset = offset;
+		offset += (uint64_t) segments[i].numPages * MEM_PAGE_SIZE;
+	}
+
+	FILE* file = fopen(filename, "wb");
+	if (file == nullptr)
+		return false;
+	mem_image_header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MEM_IMAGE_MAGIC, 8);
+	header.version = MEM_IMAGE_VERSION;
+	header.numSegments = segments.size();
+	fwrite(&header, sizeof(header), 1, file);
+	if (!segments.empty())
+		fwrite(&segments[0], sizeof(mem_image_segment_t), segments.size(), file);
+	for (uint32_t i = 0; i < segments.size(); i++) {
+		//the gap reads as zeros
+		fseek(file, segments[i].offset, SEEK_SET);
+		for (uint32_t j = 0; j < segments[i].numPages; j++)
+			fwrite(translate(segments[i].start + j * MEM_PAGE_SIZE,
+					MEM_PAGE_SIZE, false), 1, MEM_PAGE_SIZE, file);
 	}
+	bool ok = !ferror(file);
+	return fclose(file) == 0 && ok;
 }
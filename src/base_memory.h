@@ -9,45 +9,148 @@
 #include <cstdint>
 #include <cstdlib>
 #include <assert.h>
+#include <vector>
 #include "abstract_memory.h"
+#include "checkpoint.h"
 
-//initializing memory regions
+//layout of the loaded programs, the whole 32-bit space is memory
 #define MEM_DATA_START  0x10000000
-#define MEM_DATA_SIZE   0x00100000
 #define MEM_TEXT_START  0x00400000
-#define MEM_TEXT_SIZE   0x00100000
-#define MEM_STACK_START 0x7ff00000
-#define MEM_STACK_SIZE  0x00100000
-#define MEM_KDATA_START 0x90000000
-#define MEM_KDATA_SIZE  0x00100000
-#define MEM_KTEXT_START 0x80000000
-#define MEM_KTEXT_SIZE  0x00100000
-#define MEM_NREGIONS 5
+#define MEM_STACK_END   0x80000000
 
+/*
+ * the 32-bit address space is translated by a two-level page table:
+ * a directory of MEM_DIR_SIZE entries, each pointing to a table of
+ * MEM_TABLE_SIZE pages
+ */
+#define MEM_PAGE_SHIFT  12
+#define MEM_PAGE_SIZE   (1u << MEM_PAGE_SHIFT)
+#define MEM_TABLE_SHIFT 10
+#define MEM_TABLE_SIZE  (1u << MEM_TABLE_SHIFT)
+#define MEM_DIR_SHIFT   (MEM_PAGE_SHIFT + MEM_TABLE_SHIFT)
+#define MEM_DIR_SIZE    (1u << (32 - MEM_DIR_SHIFT))
+
+/*
+ * second level of the page table. A page that was never written
+ * points to the shared zero page
+ */
 typedef struct {
-	uint32_t start, size;
-	uint8_t *mem;
-} mem_region_t;
+	uint8_t* pages[MEM_TABLE_SIZE];
+} mem_page_table_t;
+
+//memory image files start with this magic and version
+#define MEM_IMAGE_MAGIC "MIPSIMG"
+#define MEM_IMAGE_VERSION 1
 
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t numSegments;
+} mem_image_header_t;
+
+/*
+ * numPages consecutive pages of a memory image starting at address
+ * start, stored at a page-aligned offset of the file
+ */
+typedef struct {
+	uint32_t start;
+	uint32_t numPages;
+	uint64_t offset;
+} mem_image_segment_t;
 
 /*
  * Main memory
  */
-class BaseMemory: public AbstractMemory {
+class BaseMemory final : public AbstractMemory {
 public:
-	BaseMemory(uint32_t mem_delay);
+	BaseMemory(SimContext* ctx, uint32_t mem_delay, uint32_t reqQueueCapacity);
 	virtual ~BaseMemory();
 	virtual bool sendReq(Packet * pkt) override;
 	virtual void recvResp(Packet* readRespPkt) override;
-	virtual void Tick() override;
+	virtual void serviceReq(Packet* pkt) override;
 	void dumpRead(uint32_t addr, uint32_t size, uint8_t* data);
+	//copies whole pages at once
+	void dumpReadRange(uint32_t addr, uint32_t len, uint8_t* buf) {
+		dumpRead(addr, len, buf);
+	}
+	void dumpWrite(uint32_t addr, uint32_t size, uint8_t* data);
+	//main memory has no state to warm
+	void warmAccess(uint32_t addr, PacketSrcType type) {}
+
+	/*
+	 * returns a host pointer to [addr, addr+size), or nullptr if the
+	 * range is empty or crosses a page. Pages that were never written
+	 * read as zero until the first forWrite translation allocates them
+	 * (and their table)
+	 */
+	uint8_t* translate(uint32_t addr, uint32_t size, bool forWrite) {
+		uint32_t last = addr + size - 1;
+		if (size == 0 || last < addr
+				|| (addr >> MEM_PAGE_SHIFT) != (last >> MEM_PAGE_SHIFT))
+			return nullptr;
+		mem_page_table_t* table = pageDir[addr >> MEM_DIR_SHIFT];
+		uint8_t* page = table->pages[(addr >> MEM_PAGE_SHIFT) & (MEM_TABLE_SIZE - 1)];
+		if (forWrite && page == zeroPage)
+			page = allocPage(addr);
+		return page + (addr & (MEM_PAGE_SIZE - 1));
+	}
+
 	/*
-	 * for the given address and size will return the
-	 * corresponding memory region
+	 * write the written pages to a checkpoint, page-aligned in the
+	 * file so that unserialize can map them back (copy-on-write)
+	 * instead of reading them
 	 */
-	mem_region_t* getMemRegion(uint32_t addr, uint32_t size);
+	void serialize(CheckpointOut& cp);
+	void unserialize(CheckpointIn& cp);
+
+	/*
+	 * A memory image is a header, the table of its segments and the
+	 * raw pages of the segments, in host byte order. loadImage maps
+	 * the pages (copy-on-write) over the current contents, saveImage
+	 * writes the written pages. Both return false if the file can't be
+	 * used, loadImage also prints the error
+	 */
+	bool loadImage(const char* filename);
+	bool saveImage(const char* filename);
+	//true if the file starts with MEM_IMAGE_MAGIC
+	static bool isImage(const char* filename);
+
+	//pages allocated by writes (or restored from a checkpoint)
+	uint64_t numPages;
+
+private:
+	//send a response to the previous level
+	void respondPrev(Packet* pkt);
+
+	//table of addr, allocated if the directory points to the zero table
+	mem_page_table_t* getTable(uint32_t addr);
+
+	//allocate the page of addr, which points to the zero page
+	uint8_t* allocPage(uint32_t addr);
+
+	//drop all the pages, the memory reads as zero again
+	void clearPages();
+
+	//addresses of the pages that are not the zero page, in order
+	void getWrittenPages(std::vector<uint32_t>& addrs);
+
+	//first level of the page table
+	mem_page_table_t* pageDir[MEM_DIR_SIZE];
+
+	//read-only page of zeros shared by the untouched pages
+	uint8_t* zeroPage;
+	//table of zero pages shared by the untouched directory entries
+	mem_page_table_t* zeroTable;
 
-	mem_region_t MEM_REGIONS[MEM_NREGIONS];
+	//host mappings that the pages are carved from
+	typedef struct {
+		uint8_t* mem;
+		uint64_t size;
+	} mem_mapping_t;
+	std::vector<mem_mapping_t> mappings;
+	//unused pages left in the last mapping
+	uint8_t* nextPage;
+	uint32_t numFreePages;
 };
 
 #endif
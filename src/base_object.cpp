@@ -6,8 +6,8 @@
 
 #include "base_object.h"
 
-BaseObject::BaseObject() {
-	// TODO Auto-generated constructor stub
+BaseObject::BaseObject(SimContext* ctx) :
+		ctx(ctx) {
 
 }
 
@@ -8,27 +8,28 @@
 #define BASE_OBJECT_H_
 #include "util.h"
 
+//max size of the data of a request, stored inline in the packet
+#define PACKET_INLINE_DATA_SIZE 8
+
 /*
  * Packet is used for communicating the memory requests between
- * core/prefetcher and caches/memory
+ * core/prefetcher and caches/memory. Packets are allocated from the
+ * PacketPool of the simulator (see packet_pool.h), never with new
  */
 class Packet {
 public:
 
 	Packet(bool _isReq, bool _isWrite, PacketSrcType _type, uint32_t _addr,
-			uint32_t _size, uint8_t* _data, uint32_t _ready_time) {
+			uint32_t _size, uint32_t _ready_time) {
 		isReq = _isReq;
 		isWrite = _isWrite;
 		type = _type;
 		addr = _addr;
 		size = _size;
-		data = _data;
+		data = inlineData;
+		cacheBlockData = nullptr;
 		ready_time = _ready_time;
 	}
-	virtual ~Packet() {
-		if (data != nullptr)
-			delete data;
-	}
 	//is this a request packet?
 	bool isReq;
 	//is this a write packet?
@@ -37,12 +38,22 @@ public:
 	PacketSrcType type;
 	uint32_t addr;
 	uint32_t size;
+	//points to inlineData
 	uint8_t* data;
 	uint32_t cacheBlockAddr;
 	uint32_t cacheBlockSize = 0;
-	uint8_t* cacheBlockData;
+	/*
+	 * non-owning view of the block being filled, pointing into the
+	 * block of the cache or the memory region that responds. It is
+	 * only valid while the response is being passed up, so the
+	 * receiving caches copy from it in their recvResp
+	 */
+	const uint8_t* cacheBlockData;
 	//when should this packet be serviced?
 	uint32_t ready_time;
+
+private:
+	uint8_t inlineData[PACKET_INLINE_DATA_SIZE];
 };
 
 /*
@@ -50,9 +61,12 @@ public:
  */
 class BaseObject {
 public:
-	BaseObject();
+	BaseObject(SimContext* ctx);
 	virtual ~BaseObject();
 
+	//the simulator instance this object belongs to
+	SimContext* ctx;
+
 	//send a request to this base object
 	virtual bool sendReq(Packet * pkt) = 0;
 	//this base object has received a packet
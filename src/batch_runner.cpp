@@ -0,0 +1,117 @@
+/*
+ * Computer Architecture CSE530
+ * MIPS pipeline cycle-accurate simulator
+ * PSU
+ */
+
+#include <cstdio>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include "batch_runner.h"
+#include "commands.h"
+
+BatchRunner::BatchRunner(uint32_t numThreads) :
+		numThreads(numThreads), nextTask(0), numFailed(0) {
+	if (this->numThreads == 0)
+		this->numThreads = std::thread::hardware_concurrency();
+	if (this->numThreads == 0)
+		this->numThreads = 1;
+}
+
+BatchRunner::~BatchRunner() {
+
+}
+
+void BatchRunner::addJob(const BatchJob& job) {
+	addTask(std::bind(&BatchRunner::runJob, job));
+}
+
+void BatchRunner::addTask(const std::function<bool()>& task) {
+	tasks.push_back(task);
+}
+
+bool BatchRunner::readJobFile(const char* filename) {
+	std::ifstream file(filename);
+	if (!file) {
+		printf("Error: Can't open job file %s\n", filename);
+		return false;
+	}
+
+	std::string line;
+	int lineNo = 0;
+	while (std::getline(file, line)) {
+		lineNo++;
+		std::istringstream fields(line);
+		BatchJob job;
+		if (!(fields >> job.configFile) || job.configFile[0] == '#')
+			continue;
+		std::string program;
+		fields >> job.scriptFile >> job.outputFile;
+		while (fields >> program)
+			job.programFiles.push_back(program);
+		if (job.programFiles.empty()) {
+			printf("Error: %s:%d: expected config script output program ...\n",
+					filename, lineNo);
+			return false;
+		}
+		addJob(job);
+	}
+	return true;
+}
+
+bool BatchRunner::runJob(BatchJob job) {
+	FILE* in = fopen(job.scriptFile.c_str(), "r");
+	if (in == NULL) {
+		printf("Error: Can't open script file %s\n", job.scriptFile.c_str());
+		return false;
+	}
+	FILE* out = fopen(job.outputFile.c_str(), "w");
+	if (out == NULL) {
+		printf("Error: Can't create output file %s\n", job.outputFile.c_str());
+		fclose(in);
+		return false;
+	}
+
+	MemHrchyInfo* info = getMemHrchyInfo(job.configFile.c_str());
+	Simulator* simulator = new Simulator(info, out);
+
+	std::vector<char*> programFiles;
+	for (uint32_t i = 0; i < job.programFiles.size(); i++)
+		programFiles.push_back(&job.programFiles[i][0]);
+	bool ok = initialize(simulator, programFiles.data(), programFiles.size());
+	if (ok) {
+		while (getCommand(simulator, in))
+			;
+		ok = !simulator->failed;
+	}
+
+	delete simulator;
+	delete info;
+	fclose(in);
+	fclose(out);
+	return ok;
+}
+
+void BatchRunner::worker() {
+	while (true) {
+		uint32_t i = nextTask++;
+		if (i >= tasks.size())
+			return;
+		if (!tasks[i]())
+			numFailed++;
+	}
+}
+
+uint32_t BatchRunner::run() {
+	nextTask = 0;
+	numFailed = 0;
+
+	std::vector<std::thread> threads;
+	for (uint32_t i = 0; i < numThreads && i < tasks.size(); i++)
+		threads.push_back(std::thread(&BatchRunner::worker, this));
+	for (uint32_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+	return numFailed;
+}
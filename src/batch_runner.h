@@ -0,0 +1,72 @@
+/*
+ * Computer Architecture CSE530
+ * MIPS pipeline cycle-accurate simulator
+ * PSU
+ */
+
+#ifndef __BATCH_RUNNER_H__
+#define __BATCH_RUNNER_H__
+
+#include <cstdint>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+
+/*
+ * One independent simulation: the config file, the command script
+ * that drives it, the file its output goes to and the programs
+ */
+struct BatchJob {
+	std::string configFile;
+	std::string scriptFile;
+	std::string outputFile;
+	std::vector<std::string> programFiles;
+};
+
+/*
+ * Runs independent Simulator instances on a pool of worker threads.
+ * Every job gets its own Simulator, script and output file, so the
+ * jobs share nothing but the pool. Other front ends (e.g. Sweep) can
+ * add their own tasks
+ */
+class BatchRunner {
+public:
+	//0 threads means one per hardware thread
+	BatchRunner(uint32_t numThreads = 0);
+	virtual ~BatchRunner();
+
+	void addJob(const BatchJob& job);
+
+	/*
+	 * add a task that runs on a worker thread and returns false if
+	 * it failed. Tasks run concurrently, they must not share any
+	 * state that is written
+	 */
+	void addTask(const std::function<bool()>& task);
+
+	/*
+	 * read jobs from a file, one per line as
+	 * "config script output program [program ...]".
+	 * Empty lines and lines starting with '#' are skipped
+	 */
+	bool readJobFile(const char* filename);
+
+	/*
+	 * run all the added jobs and tasks and wait for them to finish.
+	 * Returns the number of them that failed
+	 */
+	uint32_t run();
+
+private:
+	uint32_t numThreads;
+	std::vector<std::function<bool()>> tasks;
+	//index of the next task a worker picks up
+	std::atomic<uint32_t> nextTask;
+	std::atomic<uint32_t> numFailed;
+
+	void worker();
+	static bool runJob(BatchJob job);
+};
+
+#endif
@@ -6,37 +6,46 @@
 
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
+#include <sys/mman.h>
 #include "repl_policy.h"
 #include "next_line_prefetcher.h"
 #include "cache.h"
-#include "block.h"
+#include "packet_pool.h"
+#include "base_memory.h"
+#include "pipe.h"
 
-Cache::Cache(uint32_t size, uint32_t associativity, uint32_t blkSize,
-		enum ReplacementPolicy replType, uint32_t delay, enum CacheType cacheType):
-		AbstractMemory(delay, 100),cSize(size),
-		associativity(associativity), blkSize(blkSize), cacheType(cacheType) {
+Cache::Cache(SimContext* ctx, uint32_t size, uint32_t associativity, uint32_t blkSize,
+		enum ReplacementPolicy replType, uint32_t delay, uint32_t reqQueueCapacity,
+		enum CacheType cacheType, bool tagOnly):
+		AbstractMemory(ctx, delay, reqQueueCapacity),replType(replType),cSize(size),
+		associativity(associativity), blkSize(blkSize), tagOnly(tagOnly),
+		cacheType(cacheType), stat_hits(0), stat_misses(0) {
 
 	numSets = cSize / (blkSize * associativity);
-	blocks = new Block**[numSets];
-	for (int i = 0; i < (int) numSets; i++) {
-		blocks[i] = new Block*[associativity];
-		for (int j = 0; j < associativity; j++)
-			blocks[i][j] = new Block(blkSize);
+	assert((blkSize & (blkSize - 1)) == 0 && "Cache block size must be a power of two");
+	assert((numSets & (numSets - 1)) == 0 && "Number of cache sets must be a power of two");
+	blkShift = __builtin_ctzll(blkSize);
+	tagShift = blkShift + __builtin_ctzll(numSets);
+	setMask = numSets - 1;
+	assert(associativity <= MAX_CACHE_ASSOC && "Cache associativity is too large");
+	//the lookup kernels may read past the tags of the last set
+	tags.assign(numSets * associativity + TAG_LOOKUP_PAD, 0);
+	tagLookup = selectTagLookup(associativity);
+	validBits.assign(numSets, 0);
+	dirtyBits.assign(numSets, 0);
+
+	//the pages of the blocks that are never filled are never touched
+	blockData = nullptr;
+	blockDataSize = tagOnly ? 0 : numSets * associativity * blkSize;
+	if (blockDataSize) {
+		void* mem = mmap(nullptr, blockDataSize, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		assert(mem != MAP_FAILED && "Could not allocate cache blocks");
+		blockData = (uint8_t*) mem;
 	}
 
-	switch (replType) {
-	case RandomReplPolicy:
-		replPolicy = new RandomRepl(this);
-		break;
-	case LRUReplPolicy:
-		replPolicy = new LRURepl(this);
-		break;
-	case PLRUReplPolicy:
-		replPolicy = new PLRURepl(this);
-		break;
-	default:
-		assert(false && "Unknown Replacement Policy");
-	}
+	replPolicy = createReplacementPolicy(replType, this);
 
 	/*
 	 * add other required initialization here
@@ -49,71 +58,69 @@ Cache::Cache(uint32_t size, uint32_t associativity, uint32_t blkSize,
 
 Cache::~Cache() {
 	delete replPolicy;
-	for (int i = 0; i < (int) numSets; i++) {
-		for (int j = 0; j < associativity; j++)
-			delete blocks[i][j];
-		delete blocks[i];
-	}
-	delete blocks;
+	if (blockData)
+		munmap(blockData, blockDataSize);
 
 }
 
-uint32_t Cache::getAssociativity() {
-	return associativity;
-}
-
-uint32_t Cache::getNumSets() {
-	return numSets;
-}
-
-uint32_t Cache::getBlockSize() {
-	return blkSize;
+/*
+ * The policy classes are final, so once replType selects the class
+ * the calls are direct and the metadata updates can be inlined
+ */
+inline int Cache::getVictim(uint32_t addr, bool isWrite) {
+	switch (replType) {
+	case LRUReplPolicy:
+		return static_cast<LRURepl*>(replPolicy)->getVictim(addr, isWrite);
+	case PLRUReplPolicy:
+		return static_cast<PLRURepl*>(replPolicy)->getVictim(addr, isWrite);
+	default:
+		return static_cast<RandomRepl*>(replPolicy)->getVictim(addr, isWrite);
+	}
 }
 
-int Cache::getWay(uint32_t addr) {
-	uint32_t _addr = addr / blkSize;
-	uint32_t setIndex = (numSets - 1) & _addr;
-	uint32_t addrTag = _addr / numSets;
-	for (int i = 0; i < (int) associativity; i++) {
-		if ((blocks[setIndex][i]->getValid() == true) && (blocks[setIndex][i]->getTag() == addrTag)) {
-			return i;
-		}
+inline void Cache::updateReplPolicy(uint32_t addr, int way, bool isWrite) {
+	switch (replType) {
+	case LRUReplPolicy:
+		static_cast<LRURepl*>(replPolicy)->update(addr, way, isWrite);
+		break;
+	case PLRUReplPolicy:
+		static_cast<PLRURepl*>(replPolicy)->update(addr, way, isWrite);
+		break;
+	default:
+		static_cast<RandomRepl*>(replPolicy)->update(addr, way, isWrite);
 	}
-	return -1;
 }
 
-uint32_t Cache::getTagValue(uint32_t addr) {
-	uint32_t _addr = addr / this->blkSize;
-	uint32_t addrTag = _addr / numSets;
-
-	return addrTag;
+int Cache::getWay(uint32_t addr) {
+	uint32_t setIndex = getSetIndex(addr);
+	uint32_t addrTag = getTagValue(addr);
+	return tagLookup(&tags[setIndex * associativity], validBits[setIndex],
+			addrTag, associativity);
 }
 
-Block* Cache::getCacheBlock(uint32_t addr) {
-	uint32_t _addr = addr / blkSize;
-	uint32_t setIndex = (numSets - 1) & _addr;
 
+uint8_t* Cache::getCacheBlock(uint32_t addr) {
 	int wayIdx = getWay(addr);
 
-	if (wayIdx == -1) {
+	if (wayIdx == -1 || tagOnly) {
 		return NULL;
 	} else {
-		return blocks[setIndex][wayIdx];
+		return getData(getSetIndex(addr), wayIdx);
 	}
 }
 
-void Cache::updateBlockDataWithPktData(Block* block, Packet* pkt) {
+void Cache::updateBlockDataWithPktData(uint8_t* blkData, Packet* pkt) {
 	uint32_t blockOffset = pkt->addr & (blkSize - 1);
-	uint8_t *mem = block->getData();
+	uint8_t *mem = blkData;
 
 	for (uint32_t i = blockOffset; i < (blockOffset + pkt->size); i++) {
 		mem[i] = *(pkt->data + i - blockOffset);
 	}
 }
 
-void Cache::updatePktDataWithBlockData(Block *block, Packet *pkt) {
+void Cache::updatePktDataWithBlockData(uint8_t* blkData, Packet *pkt) {
 	uint32_t blockOffset = pkt->addr & (blkSize - 1);
-	uint8_t *mem = block->getData();
+	uint8_t *mem = blkData;
 
 	for (uint32_t i = blockOffset; i < (blockOffset + pkt->size); i++) {
 		*(pkt->data + i - blockOffset) = mem[i];
@@ -121,56 +128,86 @@ void Cache::updatePktDataWithBlockData(Block *block, Packet *pkt) {
 
 }
 
+/*
+ * In the static hierarchy an L1 sends to the L2 and responds to the
+ * core, the L2 sends to the main memory and responds to the L1s. The
+ * classes are final, so these calls are direct and can be inlined
+ */
+inline bool Cache::sendNext(Packet* pkt) {
+	if (!ctx->staticHierarchy)
+		return next->sendReq(pkt);
+	if (cacheType == L2)
+		return static_cast<BaseMemory*>(next)->sendReq(pkt);
+	return static_cast<Cache*>(next)->sendReq(pkt);
+}
+
+inline void Cache::respondPrev(BaseObject* to, Packet* pkt) {
+	if (!ctx->staticHierarchy)
+		to->recvResp(pkt);
+	else if (cacheType == L2)
+		static_cast<Cache*>(to)->recvResp(pkt);
+	else
+		static_cast<PipeState*>(to)->recvResp(pkt);
+}
+
 bool Cache::sendReq(Packet * pkt){
 	pkt->ready_time += accessDelay;
 
 	DPRINTF(DEBUG_MEMORY, "request for %d cache for pkt : addr = %x, type = %d, size = %d, ready_time = %d\n",
 			this->cacheType, pkt->addr, pkt->type, pkt->size, pkt->ready_time);
 
-	Block* block = getCacheBlock(pkt->addr);
+	uint32_t set = getSetIndex(pkt->addr);
+	int way = getWay(pkt->addr);
 
 	// Should have been called from L2 to L1D/L1I
 	if(pkt->type == PacketToInvalidate) {
-		if(block)
-			block->setValid(false);
+		if(way != -1)
+			setValid(set, way, false);
 		return true;
 	}
 
-	if(!block) {
+	if(way == -1) {
 		// Cache block not found, send the pkt to next level.
 
 		// For load/i-fetch bring block data in "pkt->blockData"
 		if(this->cacheType == L2 && !pkt->isWrite) {
 			pkt->cacheBlockAddr = pkt->addr & ~(this->blkSize - 1);
-			pkt->cacheBlockSize = this->blkSize;
-			uint8_t* blkDataFill = new uint8_t[this->blkSize];
-			pkt->cacheBlockData = blkDataFill;
+			pkt->cacheBlockSize = tagOnly ? 0 : this->blkSize;
 		}
 
-		return this->next->sendReq(pkt);
+		// a rejected request is retried, count it once it is accepted
+		bool accepted = sendNext(pkt);
+		if(accepted)
+			stat_misses++;
+		return accepted;
 	}
 	else {
 		if(pkt->isWrite) {
 			// set the block to dirty and update the data in block
-			block->setDirty(true);
-			updateBlockDataWithPktData(block, pkt);
+			setDirty(set, way, true);
+			if(!tagOnly)
+				updateBlockDataWithPktData(getData(set, way), pkt);
 
 			// write-through policy so send the pkt to next level
-			return this->next->sendReq(pkt);
+			bool accepted = sendNext(pkt);
+			if(accepted)
+				stat_hits++;
+			return accepted;
 		}
 		else {
-			if(reqQueue.size() < reqQueueCapacity) {
-				updatePktDataWithBlockData(block, pkt);
-				reqQueue.push(pkt);
-
-				return true;
+			if(pendingReqs < reqQueueCapacity) {
+				// a tag-only cache reads the data in serviceReq
+				if(!tagOnly)
+					updatePktDataWithBlockData(getData(set, way), pkt);
+				stat_hits++;
+				return scheduleReq(pkt);
 			}
 			else {
 				return false;
 			}
 		}
 		
-		replPolicy->update(pkt->addr, getWay(pkt->addr), pkt->isWrite);
+		updateReplPolicy(pkt->addr, getWay(pkt->addr), pkt->isWrite);
 	}
 }
 
@@ -179,157 +216,140 @@ void Cache::recvResp(Packet* readRespPkt){
 	DPRINTF(DEBUG_MEMORY, "recvResp for %d cache for pkt : addr = %x, type = %d, size = %d, ready_time = %d\n",
 				this->cacheType, readRespPkt->addr, readRespPkt->type, readRespPkt->size, readRespPkt->ready_time);
 
-	Block* block = getCacheBlock(readRespPkt->addr);
+	uint32_t set = getSetIndex(readRespPkt->addr);
+	int way = getWay(readRespPkt->addr);
 
 	if(readRespPkt->isWrite) {
 
-		if(block) {
-			block->setDirty(false);
+		if(way != -1) {
+			setDirty(set, way, false);
 		}
 
 		// Now send the Pkt data: from L2 to L1D -or- from L1D to pipe
 		if(this->cacheType == L2) {
-			this->prevl1d->recvResp(readRespPkt);
+			respondPrev(this->prevl1d, readRespPkt);
 		}
 		else if(this->cacheType == L1D) {
-			this->prev->recvResp(readRespPkt);
+			respondPrev(this->prev, readRespPkt);
 		}
 	}
 	else {
 		// This will be executed when there was cache miss for lw / i-fetch insn.
 		// So, either pkt is: from mem to L2 -or- from L2 to L1D/L1I
-		if(!block) {
+		if(way == -1) {
 			// block not found in cache..
 			// need to evict some other cache line and write it to cache
-			Block* evictedBlock = replPolicy->getVictim(readRespPkt->addr, readRespPkt->isWrite);
-			if(evictedBlock->getValid() && this->cacheType == L2) {
+			int evictedWay = getVictim(readRespPkt->addr, readRespPkt->isWrite);
+			if(isValid(set, evictedWay) && this->cacheType == L2) {
 				// Need to evict the cache line from L1 too
-				Packet* packetToInvalidate = new Packet(true, true, PacketToInvalidate, readRespPkt->addr,
-						readRespPkt->size, NULL, readRespPkt->ready_time);
+				Packet* packetToInvalidate = ctx->packets->alloc(true, true, PacketToInvalidate, readRespPkt->addr,
+						readRespPkt->size, readRespPkt->ready_time);
 
 				if(readRespPkt->type == PacketTypeLoad)
 					this->prevl1d->sendReq(packetToInvalidate);
 				else if(readRespPkt->type == PacketTypeFetch)
 					this->prevl1i->sendReq(packetToInvalidate);
 
-				packetToInvalidate->data = nullptr;
-				delete packetToInvalidate->data;
-				delete packetToInvalidate;
+				ctx->packets->free(packetToInvalidate);
 			}
-			// For all L2 and L1D/L1I replace 'evictedBlock' data with 'readRespPkt'
-			evictedBlock->setTag(getTagValue(readRespPkt->cacheBlockAddr));
+			// For all L2 and L1D/L1I replace 'evictedWay' data with 'readRespPkt'
+			setTag(set, evictedWay, getTagValue(readRespPkt->cacheBlockAddr));
 
-			for (uint32_t i = 0; i < readRespPkt->cacheBlockSize; i++) {
-				evictedBlock->getData()[i] = *(readRespPkt->cacheBlockData + i);
+			if(!tagOnly) {
+				memcpy(getData(set, evictedWay), readRespPkt->cacheBlockData,
+						readRespPkt->cacheBlockSize);
 			}
 
-			evictedBlock->setDirty(false);
-			evictedBlock->setValid(true);
+			setDirty(set, evictedWay, false);
+			setValid(set, evictedWay, true);
 
 			DPRINTF(DEBUG_MEMORY, "replaced evictedBlock in %d cache with pkt : addr = %x, type = %d, size = %d, ready_time = %d\n",
 							this->cacheType, readRespPkt->cacheBlockAddr, readRespPkt->type, readRespPkt->cacheBlockSize, readRespPkt->ready_time);
 
-			replPolicy->update(readRespPkt->addr, getWay(readRespPkt->addr), readRespPkt->isWrite);
+			updateReplPolicy(readRespPkt->addr, evictedWay, readRespPkt->isWrite);
 		}
 		else {
-			block->setTag(getTagValue(readRespPkt->cacheBlockAddr));
+			setTag(set, way, getTagValue(readRespPkt->cacheBlockAddr));
 
-			for (uint32_t i = 0; i < readRespPkt->cacheBlockSize; i++) {
-				block->getData()[i] = *(readRespPkt->cacheBlockData + i);
+			if(!tagOnly) {
+				memcpy(getData(set, way), readRespPkt->cacheBlockData,
+						readRespPkt->cacheBlockSize);
 			}
 
-			block->setDirty(false);
+			setDirty(set, way, false);
 		}
 
 		// Now send the Pkt data: from L2 to L1D/L1I -or- from L1D/L1I to pipe
 		if(this->cacheType == L2) {
 			if(readRespPkt->type == PacketTypeLoad)
-				this->prevl1d->recvResp(readRespPkt);
+				respondPrev(this->prevl1d, readRespPkt);
 			else if(readRespPkt->type == PacketTypeFetch)
-				this->prevl1i->recvResp(readRespPkt);
+				respondPrev(this->prevl1i, readRespPkt);
 		}
 		else if(this->cacheType == L1D || this->cacheType == L1I) {
-			delete readRespPkt->cacheBlockData;
-			this->prev->recvResp(readRespPkt);
+			respondPrev(this->prev, readRespPkt);
 		}
 	}
 
 	return;
 }
 
-void Cache::Tick(){
+void Cache::serviceReq(Packet* respPkt){
 
-	while(!reqQueue.empty()) {
-		//check if any packet is ready to be serviced
-		if (reqQueue.front()->ready_time <= currCycle) {
-			Packet* respPkt = reqQueue.front();
-			reqQueue.pop();
+	DPRINTF(DEBUG_MEMORY,"serviceReq():: cache send respond for pkt: addr = %x, ready_time = %d\n",
+						respPkt->addr, respPkt->ready_time);
 
-			DPRINTF(DEBUG_MEMORY,"Tick():: cache send respond for pkt: addr = %x, ready_time = %d\n",
-								respPkt->addr, respPkt->ready_time);
+	// packet to be send as response to prev in memory hierarchy
+	respPkt->isReq = false;
 
-			// packet to be send as response to prev in memory hierarchy
-			respPkt->isReq = false;
+	// sw instruction
+	if(respPkt->isWrite) {
 
-			// sw instruction
-			if(respPkt->isWrite) {
+		if(this->cacheType == L2) {
+			respondPrev(this->prevl1d, respPkt);
+		}
+		else if(this->cacheType == L1D){
+			respondPrev(this->prev, respPkt);
+		}
 
-				if(this->cacheType == L2) {
-					this->prevl1d->recvResp(respPkt);
-				}
-				else if(this->cacheType == L1D){
-					this->prev->recvResp(respPkt);
-				}
+	}
+	else { // lw / i-fetch
+		uint8_t* blkData = getCacheBlock(respPkt->addr);
+
+		// Set data in respPkt
+		if(this->cacheType == L2) {
+
+			respPkt->cacheBlockAddr = respPkt->addr & ~(this->blkSize - 1);
+			respPkt->cacheBlockSize = tagOnly ? 0 : this->blkSize;
+			// the L1 copies the block straight from this one
+			respPkt->cacheBlockData = blkData;
 
-			}
-			else { // lw / i-fetch
-				Block* block = getCacheBlock(respPkt->addr);
-
-				// Set data in respPkt
-				if(this->cacheType == L2) {
-
-					respPkt->cacheBlockAddr = respPkt->addr & ~(this->blkSize - 1);
-					respPkt->cacheBlockSize = this->blkSize;
-					uint8_t* blkDataFill = new uint8_t[this->blkSize];
-					respPkt->cacheBlockData = blkDataFill;
-
-					for (uint32_t i = 0; i < respPkt->cacheBlockSize; i++) {
-						*(respPkt->cacheBlockData + i) = block->getData()[i];
-					}
-
-				}
-
-				updatePktDataWithBlockData(block, respPkt);
-
-				// Now send the pkt as response to prev in memory hierarchy
-				if(this->cacheType == L2 && respPkt->type == PacketTypeFetch) {
-					this->prevl1i->recvResp(respPkt);
-				}
-				else if(this->cacheType == L2 && respPkt->type == PacketTypeLoad){
-					this->prevl1d->recvResp(respPkt);
-				}
-				else if(this->cacheType == L1D || this->cacheType == L1I){
-					this->prev->recvResp(respPkt);
-				}
-			}
 		}
-		else {
-			/*
-			 * assume that reqQueue is sorted by ready_time for now
-			 * (because the pipeline is in-order)
-			 */
-			break;
+
+		// the caches are write-through, so the memory has the latest data
+		if(tagOnly)
+			this->next->dumpRead(respPkt->addr, respPkt->size, respPkt->data);
+		else
+			updatePktDataWithBlockData(blkData, respPkt);
+
+		// Now send the pkt as response to prev in memory hierarchy
+		if(this->cacheType == L2 && respPkt->type == PacketTypeFetch) {
+			respondPrev(this->prevl1i, respPkt);
+		}
+		else if(this->cacheType == L2 && respPkt->type == PacketTypeLoad){
+			respondPrev(this->prevl1d, respPkt);
+		}
+		else if(this->cacheType == L1D || this->cacheType == L1I){
+			respondPrev(this->prev, respPkt);
 		}
 	}
-	return;
 }
 
 void Cache::dumpRead(uint32_t addr, uint32_t size, uint8_t *data) {
-	Block *block = getCacheBlock(addr);
+	uint8_t *mem = getCacheBlock(addr);
 
-	if (block) {
+	if (mem) {
 		uint32_t blockOffset = addr & (blkSize - 1);
-		uint8_t *mem = block->getData();
 
 		for (uint32_t i = blockOffset; i < (blockOffset + size); i++) {
 			*(data + i - blockOffset) = mem[i];
@@ -339,3 +359,115 @@ void Cache::dumpRead(uint32_t addr, uint32_t size, uint8_t *data) {
 	}
 
 }
+
+void Cache::dumpReadRange(uint32_t addr, uint32_t len, uint8_t *buf) {
+	//consecutive blocks that miss here
+	uint32_t missAddr = addr;
+	uint32_t missLen = 0;
+	uint8_t* missBuf = buf;
+
+	while (len > 0) {
+		uint32_t blockOffset = addr & (blkSize - 1);
+		uint32_t chunk = blkSize - blockOffset;
+		if (chunk > len)
+			chunk = len;
+		uint8_t *mem = getCacheBlock(addr);
+		if (mem) {
+			if (missLen > 0) {
+				this->next->dumpReadRange(missAddr, missLen, missBuf);
+				missLen = 0;
+			}
+			memcpy(buf, mem + blockOffset, chunk);
+		} else {
+			if (missLen == 0) {
+				missAddr = addr;
+				missBuf = buf;
+			}
+			missLen += chunk;
+		}
+		addr += chunk;
+		buf += chunk;
+		len -= chunk;
+	}
+	if (missLen > 0)
+		this->next->dumpReadRange(missAddr, missLen, missBuf);
+}
+
+void Cache::dumpWrite(uint32_t addr, uint32_t size, uint8_t *data) {
+	uint8_t *mem = getCacheBlock(addr);
+
+	if (mem) {
+		uint32_t blockOffset = addr & (blkSize - 1);
+
+		for (uint32_t i = blockOffset; i < (blockOffset + size); i++) {
+			mem[i] = *(data + i - blockOffset);
+		}
+	}
+	this->next->dumpWrite(addr, size, data);
+}
+
+void Cache::warmAccess(uint32_t addr, PacketSrcType type) {
+	if (getWay(addr) != -1)
+		return;
+
+	this->next->warmAccess(addr, type);
+
+	//same allocation as a read response in recvResp
+	uint32_t blockAddr = addr & ~(this->blkSize - 1);
+	uint32_t set = getSetIndex(addr);
+	int evictedWay = getVictim(addr, false);
+	setTag(set, evictedWay, getTagValue(blockAddr));
+	if (!tagOnly)
+		this->next->dumpRead(blockAddr, this->blkSize, getData(set, evictedWay));
+	setDirty(set, evictedWay, false);
+	setValid(set, evictedWay, true);
+
+	updateReplPolicy(addr, evictedWay, false);
+}
+
+void Cache::serialize(CheckpointOut& cp) {
+	cp.write((uint32_t) numSets);
+	cp.write((uint32_t) associativity);
+	cp.write((uint32_t) blkSize);
+	cp.write((uint32_t) replType);
+	cp.write((uint32_t) tagOnly);
+	cp.write(stat_hits);
+	cp.write(stat_misses);
+
+	for (int i = 0; i < (int) numSets; i++) {
+		for (int j = 0; j < (int) associativity; j++) {
+			cp.write(getTag(i, j));
+			cp.write(isValid(i, j));
+			cp.write(isDirty(i, j));
+			if (!tagOnly)
+				cp.write(getData(i, j), blkSize);
+		}
+	}
+	replPolicy->serialize(cp);
+}
+
+void Cache::unserialize(CheckpointIn& cp) {
+	cp.expect(numSets, "number of cache sets");
+	cp.expect(associativity, "cache associativity");
+	cp.expect(blkSize, "cache block size");
+	cp.expect(replType, "cache replacement policy");
+	cp.expect(tagOnly, "tag-only cache mode");
+	cp.read(stat_hits);
+	cp.read(stat_misses);
+
+	for (int i = 0; i < (int) numSets; i++) {
+		for (int j = 0; j < (int) associativity; j++) {
+			uint32_t tag;
+			bool valid, dirty;
+			cp.read(tag);
+			cp.read(valid);
+			cp.read(dirty);
+			if (!tagOnly)
+				cp.read(getData(i, j), blkSize);
+			setTag(i, j, tag);
+			setValid(i, j, valid);
+			setDirty(i, j, dirty);
+		}
+	}
+	replPolicy->unserialize(cp);
+}
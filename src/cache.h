@@ -7,11 +7,15 @@
 #ifndef __CACHE_H__
 #define __CACHE_H__
 
-#include "block.h"
 #include "abstract_memory.h"
 #include "abstract_prefetcher.h"
 #include "repl_policy.h"
+#include "tag_lookup.h"
 #include <cstdint>
+#include <vector>
+
+//the valid and dirty bits of a set are kept in one 64-bit word
+#define MAX_CACHE_ASSOC 64
 
 /*
  * You should implement MSHR
@@ -31,37 +35,156 @@ enum CacheType {
 /*
  * You should implement Cache
  */
-class Cache: public AbstractMemory {
+class Cache final : public AbstractMemory {
 private:
 	AbstarctReplacementPolicy *replPolicy;
+	enum ReplacementPolicy replType;
 	AbstractPrefetcher* prefetcher;
 	MSHR* mshr;
 	uint64_t cSize, associativity, blkSize, numSets;
+	/*
+	 * the block size and the number of sets are powers of two, so
+	 * the index math is done with shifts and masks:
+	 * set = (addr >> blkShift) & setMask, tag = addr >> tagShift
+	 */
+	uint32_t blkShift, tagShift, setMask;
+	/*
+	 * keep only the tags and the state of the blocks. The data of
+	 * loads and fetches is read from the next level (ultimately the
+	 * main memory, which is up to date since the caches are
+	 * write-through), so timing and results are the same
+	 */
+	bool tagOnly;
+
+	//statically dispatched calls to replPolicy
+	int getVictim(uint32_t addr, bool isWrite);
+	void updateReplPolicy(uint32_t addr, int way, bool isWrite);
+
+	//send a request to the next level and a response to a previous one
+	bool sendNext(Packet* pkt);
+	void respondPrev(BaseObject* to, Packet* pkt);
+
+	/*
+	 * Block storage, structure-of-arrays. The blocks of a set are
+	 * contiguous (block i of set s is s * associativity + i), so a
+	 * lookup touches the tags of one set and its valid bits only
+	 */
+	std::vector<uint32_t> tags;
+	//tag comparison kernel of getWay (see tag_lookup.h)
+	TagLookupFn tagLookup;
+	//per set, bit i is the valid/dirty bit of way i
+	std::vector<uint64_t> validBits;
+	std::vector<uint64_t> dirtyBits;
+	//data of all the blocks, page aligned and zero-filled on demand
+	uint8_t* blockData;
+	uint64_t blockDataSize;
 
 public:
-	//Pointer to an array of block pointers
-	Block ***blocks;
 	CacheType cacheType;
-	Cache(uint32_t _Size, uint32_t _associativity, uint32_t _blkSize,
-			enum ReplacementPolicy _replPolicy, uint32_t _delay, enum CacheType cacheType);
+
+	//statistics of the accepted loads, fetches and stores
+	uint64_t stat_hits;
+	uint64_t stat_misses;
+
+	Cache(SimContext* ctx, uint32_t _Size, uint32_t _associativity, uint32_t _blkSize,
+			enum ReplacementPolicy _replPolicy, uint32_t _delay, uint32_t _reqQueueCapacity,
+			enum CacheType cacheType, bool tagOnly = false);
 	virtual ~Cache();
 	virtual bool sendReq(Packet * pkt) override;
 	virtual void recvResp(Packet* readRespPkt) override;
-	virtual void Tick() override;
+	virtual void serviceReq(Packet* pkt) override;
 	int getWay(uint32_t addr);
-	virtual uint32_t getTagValue(uint32_t addr);
-	virtual uint32_t getAssociativity();
-	virtual uint32_t getNumSets();
-	virtual uint32_t getBlockSize();
-	virtual Block* getCacheBlock(uint32_t addr);
-	virtual void updateBlockDataWithPktData(Block* block, Packet* pkt);
-	virtual void updatePktDataWithBlockData(Block* block, Packet* pkt);
+	uint32_t getTagValue(uint32_t addr) {
+		return addr >> tagShift;
+	}
+
+	uint32_t getAssociativity() {
+		return associativity;
+	}
+
+	uint32_t getNumSets() {
+		return numSets;
+	}
+
+	uint32_t getBlockSize() {
+		return blkSize;
+	}
+
+	/*
+	 * returns the data of the block holding addr, or NULL if the
+	 * block is not in the cache or the cache is tag-only
+	 */
+	virtual uint8_t* getCacheBlock(uint32_t addr);
+	virtual void updateBlockDataWithPktData(uint8_t* blkData, Packet* pkt);
+	virtual void updatePktDataWithBlockData(uint8_t* blkData, Packet* pkt);
+
+	uint32_t getSetIndex(uint32_t addr) {
+		return (addr >> blkShift) & setMask;
+	}
+
+	//state of the block in the given way of a set
+	bool isValid(uint32_t set, int way) {
+		return (validBits[set] >> way) & 1;
+	}
+
+	bool isDirty(uint32_t set, int way) {
+		return (dirtyBits[set] >> way) & 1;
+	}
+
+	uint32_t getTag(uint32_t set, int way) {
+		return tags[set * associativity + way];
+	}
+
+	uint8_t* getData(uint32_t set, int way) {
+		return blockData + (set * associativity + way) * blkSize;
+	}
+
+	//valid bits of all the ways of a set
+	uint64_t getValidBits(uint32_t set) {
+		return validBits[set];
+	}
+
+	void setValid(uint32_t set, int way, bool flag) {
+		if (flag)
+			validBits[set] |= (uint64_t) 1 << way;
+		else
+			validBits[set] &= ~((uint64_t) 1 << way);
+	}
+
+	void setDirty(uint32_t set, int way, bool flag) {
+		if (flag)
+			dirtyBits[set] |= (uint64_t) 1 << way;
+		else
+			dirtyBits[set] &= ~((uint64_t) 1 << way);
+	}
+
+	void setTag(uint32_t set, int way, uint32_t tag) {
+		tags[set * associativity + way] = tag;
+	}
+
 	/*
 	 * read the data if it is in the cache. If it is not, read from memory.
 	 * this is not a normal read operation, this is for debug, do not use
 	 * mshr for implementing this
 	 */
 	virtual void dumpRead(uint32_t addr, uint32_t size, uint8_t* data) override;
+	virtual void dumpReadRange(uint32_t addr, uint32_t len, uint8_t* buf) override;
+	/*
+	 * update the block if it is in the cache and pass the write
+	 * to the next level (the caches are write-through)
+	 */
+	virtual void dumpWrite(uint32_t addr, uint32_t size, uint8_t* data) override;
+	/*
+	 * on a miss, allocate the block like recvResp does for a read
+	 * response; hits do not change the cache state
+	 */
+	virtual void warmAccess(uint32_t addr, PacketSrcType type) override;
+	/*
+	 * save and restore the blocks and the replacement metadata. The
+	 * geometry and the policy must match the ones of the checkpoint
+	 */
+	void serialize(CheckpointOut& cp);
+	void unserialize(CheckpointIn& cp);
 	//place other functions here if necessary
 
 };
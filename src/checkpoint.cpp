@@ -0,0 +1,131 @@
+/*
+ * Computer Architecture CSE530
+ * MIPS pipeline cycle-accurate simulator
+ * PSU
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include "checkpoint.h"
+
+CheckpointOut::CheckpointOut(const char* filename) :
+		filename(filename) {
+	file = fopen(filename, "wb");
+	if (file) {
+		uint32_t version = CKPT_VERSION;
+		write(CKPT_MAGIC, 8);
+		write(version);
+	}
+}
+
+CheckpointOut::~CheckpointOut() {
+	if (file)
+		fclose(file);
+}
+
+bool CheckpointOut::isOpen() {
+	return file != nullptr;
+}
+
+void CheckpointOut::write(const void* data, uint64_t size) {
+	//errors are sticky and reported by close()
+	fwrite(data, 1, size, file);
+}
+
+uint64_t CheckpointOut::alignToPage() {
+	uint64_t offset = ftell(file);
+	offset = (offset + CKPT_PAGE_SIZE - 1) & ~(uint64_t) (CKPT_PAGE_SIZE - 1);
+	//the gap reads as zeros
+	fseek(file, offset, SEEK_SET);
+	return offset;
+}
+
+bool CheckpointOut::close() {
+	bool ok = !ferror(file);
+	ok = fclose(file) == 0 && ok;
+	file = nullptr;
+	return ok;
+}
+
+CheckpointIn::CheckpointIn(const char* filename) :
+		filename(filename), fileSize(0) {
+	file = fopen(filename, "rb");
+	if (file == nullptr) {
+		fail("can't open the file");
+		return;
+	}
+	fseek(file, 0, SEEK_END);
+	fileSize = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	char magic[8];
+	uint32_t version;
+	read(magic, 8);
+	if (!failed() && memcmp(magic, CKPT_MAGIC, 8) != 0)
+		fail("not a checkpoint file");
+	read(version);
+	if (!failed() && version != CKPT_VERSION)
+		fail("unsupported checkpoint version");
+}
+
+CheckpointIn::~CheckpointIn() {
+	if (file)
+		fclose(file);
+}
+
+void CheckpointIn::read(void* data, uint64_t size) {
+	//after an error the reads are zeros, so the caller can finish
+	if (failed() || fread(data, 1, size, file) != size) {
+		memset(data, 0, size);
+		fail("file is truncated");
+	}
+}
+
+void CheckpointIn::expect(uint32_t value, const char* what) {
+	uint32_t saved;
+	read(saved);
+	if (!failed() && saved != value) {
+		char msg[128];
+		snprintf(msg, sizeof(msg), "%s is %u, the simulator has %u",
+				what, saved, value);
+		fail(msg);
+	}
+}
+
+void CheckpointIn::seek(uint64_t offset) {
+	if (failed() || offset > fileSize || fseek(file, offset, SEEK_SET) != 0)
+		fail("file is truncated");
+}
+
+uint64_t CheckpointIn::alignToPage() {
+	if (failed())
+		return 0;
+	uint64_t offset = ftell(file);
+	offset = (offset + CKPT_PAGE_SIZE - 1) & ~(uint64_t) (CKPT_PAGE_SIZE - 1);
+	seek(offset);
+	return offset;
+}
+
+bool CheckpointIn::has(uint64_t size) {
+	if (!failed() && size > fileSize - ftell(file))
+		fail("file is truncated");
+	return !failed();
+}
+
+int CheckpointIn::getFd() {
+	return fileno(file);
+}
+
+void CheckpointIn::fail(const char* what) {
+	//only the first error is kept, the others follow from it
+	if (error.empty())
+		error = what;
+}
+
+bool CheckpointIn::failed() {
+	return !error.empty();
+}
+
+const std::string& CheckpointIn::getError() {
+	return error;
+}
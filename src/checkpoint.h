@@ -0,0 +1,96 @@
+/*
+ * Computer Architecture CSE530
+ * MIPS pipeline cycle-accurate simulator
+ * PSU
+ */
+
+#ifndef __CHECKPOINT_H__
+#define __CHECKPOINT_H__
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#define CKPT_MAGIC "MIPSCKPT"
+#define CKPT_VERSION 5
+//memory pages start at a multiple of this so they can be mmap'd
+#define CKPT_PAGE_SIZE 4096
+
+/*
+ * Binary checkpoint file that the simulator objects serialize their
+ * state into. The file starts with CKPT_MAGIC and CKPT_VERSION, the
+ * rest is written by the objects in a fixed order. Values are stored
+ * raw, in host byte order
+ */
+class CheckpointOut {
+public:
+	CheckpointOut(const char* filename);
+	virtual ~CheckpointOut();
+
+	//false if the file could not be created
+	bool isOpen();
+
+	void write(const void* data, uint64_t size);
+	template<typename T>
+	void write(const T& value) {
+		write(&value, sizeof(T));
+	}
+
+	//move to the next page boundary of the file and return its offset
+	uint64_t alignToPage();
+
+	//flush and close the file, returns false if any write failed
+	bool close();
+
+	const char* filename;
+
+private:
+	FILE* file;
+};
+
+/*
+ * Reads a file written by CheckpointOut. Errors (a file that cannot be
+ * read or does not match the simulated configuration) are sticky: the
+ * first one is kept for getError() and the reads after it return zeros
+ */
+class CheckpointIn {
+public:
+	CheckpointIn(const char* filename);
+	virtual ~CheckpointIn();
+
+	void read(void* data, uint64_t size);
+	template<typename T>
+	void read(T& value) {
+		read(&value, sizeof(T));
+	}
+
+	//read a value that must be equal to the simulated one
+	void expect(uint32_t value, const char* what);
+
+	//move to the given offset of the file
+	void seek(uint64_t offset);
+
+	//move to the next page boundary of the file and return its offset
+	uint64_t alignToPage();
+
+	//false (and an error) if fewer than size bytes are left in the file
+	bool has(uint64_t size);
+
+	//file descriptor for mapping parts of the file
+	int getFd();
+
+	//record an error, only the first one is kept
+	void fail(const char* what);
+
+	bool failed();
+	const std::string& getError();
+
+	const char* filename;
+
+private:
+	FILE* file;
+	uint64_t fileSize;
+	std::string error;
+};
+
+#endif
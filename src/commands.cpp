@@ -0,0 +1,471 @@
+/*
+ * Computer Architecture CSE530
+ * MIPS pipeline cycle-accurate simulator
+ * PSU
+ */
+
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include "config_reader.h"
+#include "commands.h"
+#include "elf_loader.h"
+#include "util.h"
+
+/***************************************************************/
+/*                                                             */
+/* Procedure: writeProgramToMem                                */
+/*                                                             */
+/* Purpose: write the program to the memory                    */
+/*                                                             */
+/***************************************************************/
+
+void writeProgramToMem(Simulator* simulator, uint32_t address,
+		uint32_t value) {
+	uint8_t* mem = simulator->main_memory->translate(address, 4, true);
+	if (mem == NULL)
+		return;
+	mem[3] = (value >> 24) & 0xFF;
+	mem[2] = (value >> 16) & 0xFF;
+	mem[1] = (value >> 8) & 0xFF;
+	mem[0] = (value >> 0) & 0xFF;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure: getMemHrchyInfo                                  */
+/*                                                             */
+/* Purpose: Read memory hierarchy configs                      */
+/*                                                             */
+/***************************************************************/
+MemHrchyInfo* getMemHrchyInfo(const char* config_file) {
+	FILE * config;
+	int ii;
+	char line[100];
+	config = fopen(config_file, "r");
+	assert(config != NULL && "Could not open config file");
+	ii = 0;
+	std::string str;
+	while (fscanf(config, "%s\n", line) != EOF) {
+		str.append(line);
+	}
+	fclose(config);
+	ConfigReader msg;
+	msg.setJson(str);
+	std::cerr << "Config file is read successfully\n";
+	MemHrchyInfo * info = new MemHrchyInfo;
+
+	if(msg.getValue("cache_size_l1") != Json::nullValue)
+		info->cache_size_l1 = msg.getValue("cache_size_l1").asInt();
+	else
+		std::cerr << "cache_size_l1 is not defined in config.json, using default value : " << info->cache_size_l1 << "\n";
+
+	if(msg.getValue("cache_assoc_l1") != Json::nullValue)
+		info->cache_assoc_l1 = msg.getValue("cache_assoc_l1").asInt();
+	else
+		std::cerr << "cache_assoc_l1 is not defined in config.json, using default value : " << info->cache_assoc_l1 << "\n";
+
+	if(msg.getValue("cache_size_l2") != Json::nullValue)
+		info->cache_size_l2 = msg.getValue("cache_size_l2").asInt();
+	else
+		std::cerr << "cache_size_l2 is not defined in config.json, using default value : " << info->cache_size_l2 << "\n";
+
+	if(msg.getValue("cache_assoc_l2") != Json::nullValue)
+		info->cache_assoc_l2 = msg.getValue("cache_assoc_l2").asInt();
+	else
+		std::cerr << "cache_assoc_l2 is not defined in config.json, using default value : " << info->cache_assoc_l2 << "\n";
+
+	if(msg.getValue("cache_blk_size") != Json::nullValue)
+		info->cache_blk_size = msg.getValue("cache_blk_size").asInt();
+	else
+		std::cerr << "cache_blk_size is not defined in config.json, using default value : " << info->cache_blk_size << "\n";
+
+	if(msg.getValue("repl_policy_l1d") != Json::nullValue)
+		info->repl_policy_l1d = static_cast<ReplacementPolicy>(msg.getValue("repl_policy_l1d").asInt());
+	else
+		std::cerr << "repl_policy_l1d is not defined in config.json, using default value : " << info->repl_policy_l1d << "\n";
+
+	if(msg.getValue("repl_policy_l1i") != Json::nullValue)
+		info->repl_policy_l1i = static_cast<ReplacementPolicy>(msg.getValue("repl_policy_l1i").asInt());
+	else
+		std::cerr << "repl_policy_l1i is not defined in config.json, using default value : " << info->repl_policy_l1i << "\n";
+
+	if(msg.getValue("repl_policy_l2") != Json::nullValue)
+		info->repl_policy_l2 = static_cast<ReplacementPolicy>(msg.getValue("repl_policy_l2").asInt());
+	else
+		std::cerr << "repl_policy_l2 is not defined in config.json, using default value : " << info->repl_policy_l2 << "\n";
+
+	if(msg.getValue("access_delay_l1") != Json::nullValue)
+		info->access_delay_l1 = msg.getValue("access_delay_l1").asInt();
+	else
+		std::cerr << "access_delay_l1 is not defined in config.json, using default value : " << info->access_delay_l1 << "\n";
+
+	if(msg.getValue("access_delay_l2") != Json::nullValue)
+		info->access_delay_l2 = msg.getValue("access_delay_l2").asInt();
+	else
+		std::cerr << "access_delay_l2 is not defined in config.json, using default value : " << info->access_delay_l2 << "\n";
+
+	if(msg.getValue("memDelay") != Json::nullValue)
+		info->memDelay = msg.getValue("memDelay").asInt();
+	else
+		std::cerr << "memDelay is not defined in config.json, using default value : " << info->memDelay << "\n";
+
+	if(msg.getValue("req_queue_size_l1") != Json::nullValue)
+		info->req_queue_size_l1 = msg.getValue("req_queue_size_l1").asInt();
+	else
+		std::cerr << "req_queue_size_l1 is not defined in config.json, using default value : " << info->req_queue_size_l1 << "\n";
+
+	if(msg.getValue("req_queue_size_l2") != Json::nullValue)
+		info->req_queue_size_l2 = msg.getValue("req_queue_size_l2").asInt();
+	else
+		std::cerr << "req_queue_size_l2 is not defined in config.json, using default value : " << info->req_queue_size_l2 << "\n";
+
+	if(msg.getValue("req_queue_size_mem") != Json::nullValue)
+		info->req_queue_size_mem = msg.getValue("req_queue_size_mem").asInt();
+	else
+		std::cerr << "req_queue_size_mem is not defined in config.json, using default value : " << info->req_queue_size_mem << "\n";
+
+
+	if(msg.getValue("bht_entries") != Json::nullValue)
+		info->bht_entries = msg.getValue("bht_entries").asInt();
+	else
+		std::cerr << "bht_entries is not defined in config.json, using default value : " << info->bht_entries << "\n";
+
+	if(msg.getValue("bht_entry_width") != Json::nullValue)
+		info->bht_entry_width = msg.getValue("bht_entry_width").asInt();
+	else
+		std::cerr << "bht_entry_width is not defined in config.json, using default value : " << info->bht_entry_width << "\n";
+
+	if(msg.getValue("pht_width") != Json::nullValue)
+		info->pht_width = msg.getValue("pht_width").asInt();
+	else
+		std::cerr << "pht_width is not defined in config.json, using default value : " << info->pht_width << "\n";
+
+	if(msg.getValue("btb_size") != Json::nullValue)
+		info->btb_size = msg.getValue("btb_size").asInt();
+	else
+		std::cerr << "btb_size is not defined in config.json, using default value : " << info->btb_size << "\n";
+
+	if(msg.getValue("skipIdleCycles") != Json::nullValue)
+		info->skipIdleCycles = msg.getValue("skipIdleCycles").asBool();
+	if(msg.getValue("cacheTagOnly") != Json::nullValue)
+		info->cacheTagOnly = msg.getValue("cacheTagOnly").asBool();
+
+	if(msg.getValue("debugMemory") != Json::nullValue)
+		info->debugMemory = msg.getValue("debugMemory").asBool();
+	if(msg.getValue("debugPipe") != Json::nullValue)
+		info->debugPipe = msg.getValue("debugPipe").asBool();
+	if(msg.getValue("debugCache") != Json::nullValue)
+		info->debugCache = msg.getValue("debugCache").asBool();
+	if(msg.getValue("debugPrefetch") != Json::nullValue)
+		info->debugPrefetch = msg.getValue("debugPrefetch").asBool();
+	if(msg.getValue("debugAll") != Json::nullValue && msg.getValue("debugAll").asBool())
+		info->debugMemory = info->debugPipe = info->debugCache = info->debugPrefetch = true;
+	if(msg.getValue("traceMemory") != Json::nullValue)
+		info->traceMemory = msg.getValue("traceMemory").asBool();
+
+	return info;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : setMemHrchyParam                                */
+/*                                                             */
+/* Purpose   : Set a config parameter by its config.json name  */
+/*                                                             */
+/***************************************************************/
+bool setMemHrchyParam(MemHrchyInfo* info, const std::string& name,
+		int64_t value) {
+	if (name == "cache_size_l1")
+		info->cache_size_l1 = value;
+	else if (name == "cache_assoc_l1")
+		info->cache_assoc_l1 = value;
+	else if (name == "cache_size_l2")
+		info->cache_size_l2 = value;
+	else if (name == "cache_assoc_l2")
+		info->cache_assoc_l2 = value;
+	else if (name == "cache_blk_size")
+		info->cache_blk_size = value;
+	else if (name == "repl_policy_l1i")
+		info->repl_policy_l1i = static_cast<ReplacementPolicy>(value);
+	else if (name == "repl_policy_l1d")
+		info->repl_policy_l1d = static_cast<ReplacementPolicy>(value);
+	else if (name == "repl_policy_l2")
+		info->repl_policy_l2 = static_cast<ReplacementPolicy>(value);
+	else if (name == "access_delay_l1")
+		info->access_delay_l1 = value;
+	else if (name == "access_delay_l2")
+		info->access_delay_l2 = value;
+	else if (name == "memDelay")
+		info->memDelay = value;
+	else if (name == "req_queue_size_l1")
+		info->req_queue_size_l1 = value;
+	else if (name == "req_queue_size_l2")
+		info->req_queue_size_l2 = value;
+	else if (name == "req_queue_size_mem")
+		info->req_queue_size_mem = value;
+	else if (name == "bht_entries")
+		info->bht_entries = value;
+	else if (name == "bht_entry_width")
+		info->bht_entry_width = value;
+	else if (name == "pht_width")
+		info->pht_width = value;
+	else if (name == "btb_size")
+		info->btb_size = value;
+	else if (name == "skipIdleCycles")
+		info->skipIdleCycles = value;
+	else if (name == "cacheTagOnly")
+		info->cacheTagOnly = value;
+	else
+		return false;
+	return true;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : help                                            */
+/*                                                             */
+/* Purpose   : Print out a list of commands                    */
+/*                                                             */
+/***************************************************************/
+void help(FILE* out) {
+	fprintf(out, "----------------MIPS ISIM Help-----------------------\n");
+	fprintf(out, "go                     -  run program to completion         \n");
+	fprintf(out, "run n                  -  execute program for n instructions\n");
+	fprintf(out, "ff n                   -  fast-forward n instructions functionally\n");
+	fprintf(out, "sample k u w           -  sampled run: u of every k instructions\n");
+	fprintf(out, "                          measured after w detailed warm-up\n");
+	fprintf(out, "ckpt save|load file    -  save/restore the simulator state\n");
+	fprintf(out, "image file             -  write the final memory to a memory image\n");
+	fprintf(out, 
+			"registerDump                  -  dump architectural registers      \n");
+	fprintf(out, "memDump low high         -  dump memory from low to high      \n");
+	fprintf(out, "mhex low high          -  dump memory as hex bytes          \n");
+	fprintf(out, "mbin low high file     -  write memory to a binary file     \n");
+	fprintf(out, "input reg_no reg_value - set GPR reg_no to reg_value  \n");
+	fprintf(out, "?                      -  display this help menu            \n");
+	fprintf(out, "quit                   -  exit the program                  \n\n");
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : getCommand                                     */
+/*                                                             */
+/* Purpose   : Read a command from the input file.          */
+/*                                                             */
+/***************************************************************/
+bool getCommand(Simulator* simulator, FILE* in) {
+	FILE* out = simulator->ctx.out;
+	char buffer[20];
+	int start, stop, cycles;
+	int register_no, register_value;
+	unsigned long insts, interval, unit, warmup;
+	char action[20], filename[256];
+
+	fprintf(out, "SIM> ");
+
+	//End of commands
+	if (fscanf(in, "%s", buffer) == EOF)
+		return false;
+
+	fprintf(out, "\n");
+
+	switch (buffer[0]) {
+	case 'G':
+	case 'g':
+		simulator->go();
+		break;
+
+	case 'F':
+	case 'f':
+		if (fscanf(in, "%lu", &insts) != 1)
+			break;
+		simulator->fastForward(insts);
+		break;
+
+	case 'S':
+	case 's':
+		if (fscanf(in, "%lu %lu %lu", &interval, &unit, &warmup) != 3)
+			break;
+		simulator->sample(interval, unit, warmup);
+		break;
+
+	case 'C':
+	case 'c':
+		if (fscanf(in, "%19s %255s", action, filename) != 2)
+			break;
+		if (strcmp(action, "save") == 0)
+			simulator->saveCheckpoint(filename);
+		else if (strcmp(action, "load") == 0)
+			simulator->loadCheckpoint(filename);
+		else
+			fprintf(out, "Invalid Command\n");
+		break;
+
+	case 'M':
+	case 'm':
+		if (fscanf(in, "%i %i", &start, &stop) != 2)
+			break;
+
+		if (buffer[1] == 'h' || buffer[1] == 'H')
+			simulator->memDumpHex(start, stop);
+		else if (buffer[1] == 'b' || buffer[1] == 'B') {
+			if (fscanf(in, "%255s", filename) != 1)
+				break;
+			simulator->memDumpBinary(start, stop, filename);
+		} else
+			simulator->memDump(start, stop);
+		break;
+
+	case '?':
+		help(out);
+		break;
+	case 'Q':
+	case 'q':
+		fprintf(out, "Bye.\n");
+		return false;
+
+	case 'R':
+	case 'r':
+		if (buffer[1] == 'd' || buffer[1] == 'D')
+			simulator->registerDump();
+		else {
+			if (fscanf(in, "%d", &cycles) != 1)
+				break;
+			simulator->run(cycles);
+		}
+		break;
+
+	case 'I':
+	case 'i':
+		if (buffer[1] == 'm' || buffer[1] == 'M') {
+			if (fscanf(in, "%255s", filename) != 1)
+				break;
+			simulator->saveMemImage(filename);
+			break;
+		}
+		if (fscanf(in, "%i %i", &register_no, &register_value) != 2)
+			break;
+
+		fprintf(out, "%i %i\n", register_no, register_value);
+		simulator->pipe->REGS[register_no] = register_value;
+		break;
+
+	case 'H':
+	case 'h':
+		if (fscanf(in, "%i", &register_value) != 1)
+			break;
+
+		simulator->pipe->HI = register_value;
+		break;
+
+	case 'L':
+	case 'l':
+		if (fscanf(in, "%i", &register_value) != 1)
+			break;
+
+		simulator->pipe->LO = register_value;
+		break;
+
+	default:
+		fprintf(out, "Invalid Command\n");
+		break;
+	}
+	return true;
+}
+
+/**************************************************************/
+/*                                                            */
+/* Procedure : readProgram                                   */
+/*                                                            */
+/* Purpose   : Read the words of a program file.              */
+/*                                                            */
+/**************************************************************/
+bool readProgram(const char *program_filename, std::vector<uint32_t>& words) {
+	FILE * prog;
+	int word;
+
+	/* Open program file. */
+	prog = fopen(program_filename, "r");
+	if (prog == NULL) {
+		printf("Error: Can't open program file %s\n", program_filename);
+		return false;
+	}
+	if (BaseMemory::isImage(program_filename) || isElf(program_filename)) {
+		printf("Error: Program %s is not a hex program file\n", program_filename);
+		fclose(prog);
+		return false;
+	}
+
+	/* Read in the program. */
+	words.clear();
+	while (fscanf(prog, "%x\n", &word) != EOF)
+		words.push_back(word);
+
+	fclose(prog);
+	return true;
+}
+
+/**************************************************************/
+/*                                                            */
+/* Procedure : loadProgramWords                              */
+/*                                                            */
+/* Purpose   : Write the words of a program into mem.         */
+/*                                                            */
+/**************************************************************/
+void loadProgramWords(Simulator* simulator, const std::vector<uint32_t>& words) {
+	for (uint32_t ii = 0; ii < words.size(); ii++)
+		writeProgramToMem(simulator, MEM_TEXT_START + ii * 4, words[ii]);
+
+	fprintf(simulator->ctx.out, "Read %d words from program into memory.\n\n",
+			(int) words.size());
+}
+
+/**************************************************************/
+/*                                                            */
+/* Procedure : loadProgram                                   */
+/*                                                            */
+/* Purpose   : Load program and service routines into mem.    */
+/*                                                            */
+/**************************************************************/
+bool loadProgram(Simulator* simulator, const char *program_filename) {
+	//memory images are mapped as they are
+	if (BaseMemory::isImage(program_filename)) {
+		if (!simulator->main_memory->loadImage(program_filename))
+			return false;
+		fprintf(simulator->ctx.out, "Mapped memory image %s into memory.\n\n",
+				program_filename);
+		return true;
+	}
+	if (isElf(program_filename))
+		return loadElf(simulator, program_filename);
+
+	std::vector<uint32_t> words;
+	if (!readProgram(program_filename, words))
+		return false;
+	loadProgramWords(simulator, words);
+	return true;
+}
+
+
+/************************************************************/
+/*                                                          */
+/* Procedure : initialize                                   */
+/*                                                          */
+/* Purpose   : Load machine language program                */
+/*             and set up initial state of the machine.     */
+/*                                                          */
+/************************************************************/
+bool initialize(Simulator* simulator, char* program_files[],
+		int num_prog_files) {
+	int i;
+	for (i = 0; i < num_prog_files; i++) {
+		if (!loadProgram(simulator, program_files[i]))
+			return false;
+	}
+	simulator->pipe->RUN_BIT = true;
+	return true;
+}
@@ -0,0 +1,68 @@
+/*
+ * Computer Architecture CSE530
+ * MIPS pipeline cycle-accurate simulator
+ * PSU
+ */
+
+#ifndef __COMMANDS_H__
+#define __COMMANDS_H__
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "simulator.h"
+
+/*
+ * Front end of the simulator: reading the configuration, loading the
+ * programs and the interactive commands. Everything works on the given
+ * Simulator instance, so several of them can be driven at once
+ */
+
+//write a word of the program to the main memory
+void writeProgramToMem(Simulator* simulator, uint32_t address,
+		uint32_t value);
+
+/*
+ * Read memory hierarchy configs. The caller owns the returned object
+ */
+MemHrchyInfo* getMemHrchyInfo(const char* config_file);
+
+/*
+ * Set the parameter with the given config.json name. Returns false
+ * if there is no such parameter
+ */
+bool setMemHrchyParam(MemHrchyInfo* info, const std::string& name,
+		int64_t value);
+
+//print out a list of commands
+void help(FILE* out);
+
+/*
+ * Read and execute a command from in. Returns false at the end of
+ * the commands (quit or end of file)
+ */
+bool getCommand(Simulator* simulator, FILE* in);
+
+/*
+ * Read the words of a program file, so that it can be loaded into
+ * several simulators. Returns false if the file can't be read
+ */
+bool readProgram(const char *program_filename, std::vector<uint32_t>& words);
+
+//write the words read by readProgram to the text segment
+void loadProgramWords(Simulator* simulator, const std::vector<uint32_t>& words);
+
+/*
+ * Load a program (hex words, an ELF executable or a memory image)
+ * into the memory. Returns false if the file can't be read
+ */
+bool loadProgram(Simulator* simulator, const char *program_filename);
+
+/*
+ * Load the programs and set up initial state of the machine. Returns
+ * false if a program can't be read
+ */
+bool initialize(Simulator* simulator, char* program_files[],
+		int num_prog_files);
+
+#endif
@@ -2,41 +2,28 @@
 #include <cstdio>
 #include <cmath>
 #include <cstring>
-#include "config_reader.h"
-DynamicBranchPredictor::DynamicBranchPredictor() {
-	//Read config.json file
-	FILE* config;
-	char line[100];
-	config = fopen("config.json", "r");
-	// assert(config != NULL && "Could not open config file");
-	std::string str;
-	while (fscanf(config, "%s\n", line) != EOF) {
-		str.append(line);
-	}
-	fclose(config);
-	ConfigReader msg;
-	msg.setJson(str);
-
-	int bht_entries = msg.getValue("bht_entries").asInt();
-	int pht_entries = pow(2, msg.getValue("bht_entry_width").asInt());
+DynamicBranchPredictor::DynamicBranchPredictor(int bht_entries,
+		int bht_entry_width, int pht_width, int btb_size) {
+	//the sizes come from the config (see getMemHrchyInfo)
+	int pht_entries = pow(2, bht_entry_width);
 	// predictor = (struct Predictor*)malloc(
 	// 	sizeof(struct Predictor*)
 	// 	+ sizeof(int) * bht_entries + sizeof(int) * pht_entries);
 
 	predictor = new Predictor;
 
-	predictor->bht_entries = msg.getValue("bht_entries").asInt();
-	predictor->bht_entry_width = msg.getValue("bht_entry_width").asInt();
-	predictor->pht_width = msg.getValue("pht_width").asInt();
-	predictor->btb_size = msg.getValue("btb_size").asInt();
+	predictor->bht_entries = bht_entries;
+	predictor->bht_entry_width = bht_entry_width;
+	predictor->pht_width = pht_width;
+	predictor->btb_size = btb_size;
 
 	predictor->index_pc_bits = log2(predictor->bht_entries);
 	predictor->pht_values = pow(2, predictor->pht_width);
 	predictor->index_btb_bits = log2(predictor->btb_size);
 
 	//Initialise BH, PHT and BTB with default values
-	predictor->bht = new int[predictor->bht_entries];
-	predictor->pht = new int[pht_entries];
+	predictor->bht = new int[predictor->bht_entries]();
+	predictor->pht = new int[pht_entries]();
 
 	btb = new BTB[predictor->btb_size];
 	for (int i = 0; i < predictor->btb_size; i++) {
@@ -171,4 +158,24 @@ bool DynamicBranchPredictor::checkMisprediction(uint32_t PC, bool taken) {
 		mispred = false;
 	}
 	return mispred;
+}
+
+void DynamicBranchPredictor::serialize(CheckpointOut& cp) {
+	int pht_entries = 1 << predictor->bht_entry_width;
+	cp.write((uint32_t) predictor->bht_entries);
+	cp.write((uint32_t) pht_entries);
+	cp.write((uint32_t) predictor->btb_size);
+	cp.write(predictor->bht, sizeof(int) * predictor->bht_entries);
+	cp.write(predictor->pht, sizeof(int) * pht_entries);
+	cp.write(btb, sizeof(BTB) * predictor->btb_size);
+}
+
+void DynamicBranchPredictor::unserialize(CheckpointIn& cp) {
+	int pht_entries = 1 << predictor->bht_entry_width;
+	cp.expect(predictor->bht_entries, "number of BHT entries");
+	cp.expect(pht_entries, "number of PHT entries");
+	cp.expect(predictor->btb_size, "BTB size");
+	cp.read(predictor->bht, sizeof(int) * predictor->bht_entries);
+	cp.read(predictor->pht, sizeof(int) * pht_entries);
+	cp.read(btb, sizeof(BTB) * predictor->btb_size);
 }
\ No newline at end of file
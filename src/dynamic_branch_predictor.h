@@ -26,13 +26,16 @@ typedef struct BTB {
  */
 class DynamicBranchPredictor : public AbstractBranchPredictor {
 public:
-	DynamicBranchPredictor();
+	DynamicBranchPredictor(int bht_entries, int bht_entry_width,
+			int pht_width, int btb_size);
 	virtual ~DynamicBranchPredictor();
 	Predictor* predictor;
 	BTB* btb;
 	virtual uint32_t getTarget(uint32_t PC) override;
 	virtual void update(uint32_t PC, bool taken, uint32_t target) override;
 	virtual bool checkMisprediction(uint32_t PC, bool taken) override;
+	virtual void serialize(CheckpointOut& cp) override;
+	virtual void unserialize(CheckpointIn& cp) override;
 };
 
 #endif /* SRC_DYNAMIC_BRANCH_PREDICTOR_H_ */
\ No newline at end of file
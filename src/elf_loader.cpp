@@ -0,0 +1,203 @@
+/*
+ * Computer Architecture CSE530
+ * MIPS pipeline cycle-accurate simulator
+ * PSU
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <elf.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "elf_loader.h"
+
+/*
+ * A mapped little endian ELF file, its fields are in the host byte
+ * order
+ */
+class ElfFile {
+public:
+	ElfFile(const uint8_t* data, uint64_t size) :
+			data(data), size(size) {
+	}
+
+	//pointer to count entries of T at offset, nullptr if out of the file
+	template<typename T>
+	const T* at(uint64_t offset, uint64_t count = 1) {
+		if (offset + count * sizeof(T) > size)
+			return nullptr;
+		return (const T*) (data + offset);
+	}
+
+	const uint8_t* data;
+	uint64_t size;
+};
+
+//print the error of an ELF file and return false
+static bool elfError(const char* filename, const char* what) {
+	printf("Error: ELF program %s: %s\n", filename, what);
+	return false;
+}
+
+bool isElf(const char* filename) {
+	char magic[SELFMAG];
+	FILE* file = fopen(filename, "rb");
+	if (file == NULL)
+		return false;
+	bool elf = fread(magic, 1, SELFMAG, file) == SELFMAG
+			&& memcmp(magic, ELFMAG, SELFMAG) == 0;
+	fclose(file);
+	return elf;
+}
+
+//value of the _gp symbol, or ELF_DEFAULT_GP if there is none
+static uint32_t findGp(ElfFile& elf, const Elf32_Ehdr* ehdr) {
+	uint32_t shnum = ehdr->e_shnum;
+	const Elf32_Shdr* shdrs = elf.at<Elf32_Shdr>(ehdr->e_shoff, shnum);
+	if (shdrs == NULL || ehdr->e_shentsize != sizeof(Elf32_Shdr))
+		return ELF_DEFAULT_GP;
+
+	for (uint32_t i = 0; i < shnum; i++) {
+		if (shdrs[i].sh_type != SHT_SYMTAB)
+			continue;
+		uint32_t strIndex = shdrs[i].sh_link;
+		if (strIndex >= shnum)
+			continue;
+		uint32_t count = shdrs[i].sh_size / sizeof(Elf32_Sym);
+		const Elf32_Sym* syms = elf.at<Elf32_Sym>(shdrs[i].sh_offset,
+				count);
+		uint32_t strOffset = shdrs[strIndex].sh_offset;
+		uint32_t strSize = shdrs[strIndex].sh_size;
+		const char* strs = elf.at<char>(strOffset, strSize);
+		if (syms == NULL || strs == NULL)
+			continue;
+		for (uint32_t j = 0; j < count; j++) {
+			uint32_t name = syms[j].st_name;
+			//"_gp" and its NUL must fit inside the string table
+			if (name < strSize && strSize - name >= 4
+					&& strcmp(strs + name, "_gp") == 0)
+				return syms[j].st_value;
+		}
+	}
+	return ELF_DEFAULT_GP;
+}
+
+//check that a loadable segment is in the file and in the address space
+static bool checkSegment(ElfFile& elf, const Elf32_Phdr* phdr,
+		const char* filename) {
+	uint32_t vaddr = phdr->p_vaddr;
+	uint32_t fileSize = phdr->p_filesz;
+	uint32_t memSize = phdr->p_memsz;
+	if (fileSize > memSize)
+		return elfError(filename, "segment is larger in the file than in memory");
+	if ((uint64_t) vaddr + memSize > (1ull << 32))
+		return elfError(filename, "segment exceeds the address space");
+	const uint8_t* src = elf.at<uint8_t>(phdr->p_offset, fileSize);
+	if (src == NULL)
+		return elfError(filename, "file is truncated");
+	return true;
+}
+
+//copy a checked segment to the memory and zero the rest of it
+static void copySegment(Simulator* simulator, ElfFile& elf,
+		const Elf32_Phdr* phdr) {
+	BaseMemory* mem = simulator->main_memory;
+	uint32_t vaddr = phdr->p_vaddr;
+	uint32_t fileSize = phdr->p_filesz;
+	uint32_t memSize = phdr->p_memsz;
+	const uint8_t* src = elf.at<uint8_t>(phdr->p_offset, fileSize);
+
+	uint8_t page[MEM_PAGE_SIZE];
+	uint32_t offset = 0;
+	while (offset < memSize) {
+		//up to the end of the page
+		uint32_t addr = vaddr + offset;
+		uint32_t chunk = MEM_PAGE_SIZE - (addr & (MEM_PAGE_SIZE - 1));
+		if (chunk > memSize - offset)
+			chunk = memSize - offset;
+		uint32_t copied = 0;
+		if (offset < fileSize) {
+			copied = std::min(chunk, fileSize - offset);
+			memcpy(page, src + offset, copied);
+		}
+		//the rest of the segment (.bss) is zero
+		memset(page + copied, 0, chunk - copied);
+		mem->dumpWrite(addr, chunk, page);
+		offset += chunk;
+	}
+}
+
+bool loadElf(Simulator* simulator, const char* filename) {
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		printf("Error: Can't open program file %s\n", filename);
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return elfError(filename, "can't read the file");
+	}
+	//the segments are copied straight from the mapped file
+	void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return elfError(filename, "can't map the file");
+
+	ElfFile elf((const uint8_t*) data, st.st_size);
+	const Elf32_Ehdr* ehdr = elf.at<Elf32_Ehdr>(0);
+	bool ok = false;
+	if (ehdr == NULL || ehdr->e_ident[EI_CLASS] != ELFCLASS32)
+		elfError(filename, "not a 32-bit ELF file");
+	else if (ehdr->e_ident[EI_DATA] == ELFDATA2MSB)
+		//swapping the words would break the byte and halfword accesses
+		elfError(filename,
+				"big endian program, the simulated machine is little endian");
+	else if (ehdr->e_ident[EI_DATA] != ELFDATA2LSB)
+		elfError(filename, "unknown byte order");
+	else if (ehdr->e_machine != EM_MIPS)
+		elfError(filename, "not a MIPS program");
+	else if (ehdr->e_type != ET_EXEC)
+		elfError(filename, "not an executable");
+	else if (ehdr->e_phentsize != sizeof(Elf32_Phdr))
+		elfError(filename, "bad program header size");
+	else
+		ok = true;
+
+	const Elf32_Phdr* phdrs = NULL;
+	uint32_t phnum = 0;
+	if (ok) {
+		phnum = ehdr->e_phnum;
+		phdrs = elf.at<Elf32_Phdr>(ehdr->e_phoff, phnum);
+		if (phdrs == NULL)
+			ok = elfError(filename, "file is truncated");
+	}
+
+	//check all the segments before writing any of them
+	uint32_t numSegments = 0;
+	for (uint32_t i = 0; ok && i < phnum; i++) {
+		if (phdrs[i].p_type != PT_LOAD)
+			continue;
+		ok = checkSegment(elf, &phdrs[i], filename);
+		numSegments++;
+	}
+	for (uint32_t i = 0; ok && i < phnum; i++) {
+		if (phdrs[i].p_type == PT_LOAD)
+			copySegment(simulator, elf, &phdrs[i]);
+	}
+
+	if (ok) {
+		PipeState* pipe = simulator->pipe;
+		pipe->PC = ehdr->e_entry;
+		pipe->REGS[29] = ELF_STACK_TOP;
+		pipe->REGS[28] = findGp(elf, ehdr);
+		fprintf(simulator->ctx.out,
+				"Read %u segments from ELF program into memory, entry 0x%08x.\n\n",
+				numSegments, pipe->PC);
+	}
+	munmap(data, st.st_size);
+	return ok;
+}
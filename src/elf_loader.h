@@ -0,0 +1,29 @@
+/*
+ * Computer Architecture CSE530
+ * MIPS pipeline cycle-accurate simulator
+ * PSU
+ */
+
+#ifndef __ELF_LOADER_H__
+#define __ELF_LOADER_H__
+
+#include "simulator.h"
+
+//initial stack pointer of an ELF program, 16-byte aligned
+#define ELF_STACK_TOP (MEM_STACK_END - 16)
+//global pointer if the program has no _gp symbol (MIPS ABI convention)
+#define ELF_DEFAULT_GP (MEM_DATA_START + 0x8000)
+
+//true if the file starts with the ELF magic
+bool isElf(const char* filename);
+
+/*
+ * Load a little endian MIPS32 ELF executable: copy the loadable
+ * segments (.text, .data, and zero .bss) to their virtual addresses,
+ * set PC to the entry point and initialize $sp and $gp. The simulated
+ * machine is little endian, so big endian programs are rejected.
+ * Prints the error and returns false if the file can't be loaded
+ */
+bool loadElf(Simulator* simulator, const char* filename);
+
+#endif
@@ -0,0 +1,153 @@
+/*
+ * Computer Architecture CSE530
+ * MIPS pipeline cycle-accurate simulator
+ * PSU
+ */
+
+#include <cassert>
+#include "event_queue.h"
+#include "abstract_memory.h"
+
+//number of event nodes allocated at once
+#define EVENT_CHUNK_SIZE 256
+
+EventQueue::EventQueue(uint32_t _numSlots) :
+		numPending(0), numObjects(0), overflowMin(UINT64_MAX), now(0), freeList(
+				nullptr) {
+	//round up to a power of two and to at least one mask word
+	numSlots = 64;
+	while (numSlots < _numSlots)
+		numSlots <<= 1;
+	slotActive.assign(numSlots, 0);
+	slotMask.assign(numSlots / 64, 0);
+}
+
+EventQueue::~EventQueue() {
+	for (uint32_t i = 0; i < chunks.size(); i++)
+		delete[] chunks[i];
+}
+
+void EventQueue::addObject(AbstractMemory* obj) {
+	assert(numPending == 0 && "objects must be added before scheduling");
+	assert(numObjects < MAX_EVENT_OBJECTS && "too many memory objects");
+	obj->eventQueue = this;
+	obj->eventPriority = numObjects++;
+	slots.assign((uint64_t) numSlots * numObjects, EventList { nullptr, nullptr });
+}
+
+Event* EventQueue::allocEvent() {
+	if (freeList == nullptr) {
+		Event* chunk = new Event[EVENT_CHUNK_SIZE];
+		chunks.push_back(chunk);
+		for (int i = 0; i < EVENT_CHUNK_SIZE; i++)
+			freeEvent(&chunk[i]);
+	}
+	Event* ev = freeList;
+	freeList = ev->next;
+	return ev;
+}
+
+void EventQueue::freeEvent(Event* ev) {
+	ev->next = freeList;
+	freeList = ev;
+}
+
+void EventQueue::insert(Event* ev) {
+	uint32_t slot = ev->when & (numSlots - 1);
+	EventList& list = slots[(uint64_t) slot * numObjects
+			+ ev->target->eventPriority];
+	ev->next = nullptr;
+	if (list.tail)
+		list.tail->next = ev;
+	else
+		list.head = ev;
+	list.tail = ev;
+	slotActive[slot] |= (uint64_t) 1 << ev->target->eventPriority;
+	slotMask[slot >> 6] |= (uint64_t) 1 << (slot & 63);
+}
+
+void EventQueue::schedule(AbstractMemory* target, Packet* pkt) {
+	Event* ev = allocEvent();
+	ev->target = target;
+	ev->pkt = pkt;
+	/*
+	 * the current cycle is already serviced (the caller runs after
+	 * serviceEvents), so a late packet is serviced in the next one
+	 */
+	ev->when = pkt->ready_time > now ? pkt->ready_time : now + 1;
+	numPending++;
+
+	if (ev->when - now < numSlots) {
+		insert(ev);
+	} else {
+		overflow.push_back(ev);
+		if (ev->when < overflowMin)
+			overflowMin = ev->when;
+	}
+}
+
+void EventQueue::refillFromOverflow() {
+	overflowMin = UINT64_MAX;
+	uint32_t kept = 0;
+	for (uint32_t i = 0; i < overflow.size(); i++) {
+		Event* ev = overflow[i];
+		if (ev->when - now < numSlots) {
+			insert(ev);
+		} else {
+			overflow[kept++] = ev;
+			if (ev->when < overflowMin)
+				overflowMin = ev->when;
+		}
+	}
+	overflow.resize(kept);
+}
+
+void EventQueue::serviceEvents(uint64_t cycle) {
+	now = cycle;
+	if (overflowMin - now < numSlots)
+		refillFromOverflow();
+
+	uint32_t slot = cycle & (numSlots - 1);
+	uint64_t active = slotActive[slot];
+	if (active == 0)
+		return;
+
+	//visit the active objects in priority order
+	while (active) {
+		uint32_t obj = __builtin_ctzll(active);
+		active &= active - 1;
+
+		EventList& list = slots[(uint64_t) slot * numObjects + obj];
+		while (list.head) {
+			Event* ev = list.head;
+			list.head = ev->next;
+			if (list.head == nullptr)
+				list.tail = nullptr;
+			numPending--;
+
+			AbstractMemory* target = ev->target;
+			Packet* pkt = ev->pkt;
+			freeEvent(ev);
+			target->pendingReqs--;
+			target->serviceReq(pkt);
+		}
+	}
+	slotActive[slot] = 0;
+	slotMask[slot >> 6] &= ~((uint64_t) 1 << (slot & 63));
+}
+
+uint64_t EventQueue::nextEventTime() {
+	if (numPending == 0)
+		return UINT64_MAX;
+
+	//slots hold the cycles now+1 .. now+numSlots, starting after 'now'
+	uint32_t start = (now + 1) & (numSlots - 1);
+	for (uint32_t n = 0; n < numSlots;) {
+		uint32_t slot = (start + n) & (numSlots - 1);
+		uint64_t word = slotMask[slot >> 6] >> (slot & 63);
+		if (word)
+			return now + 1 + n + __builtin_ctzll(word);
+		n += 64 - (slot & 63);
+	}
+	return overflowMin;
+}
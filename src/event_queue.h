@@ -0,0 +1,103 @@
+/*
+ * Computer Architecture CSE530
+ * MIPS pipeline cycle-accurate simulator
+ * PSU
+ */
+
+#ifndef __EVENT_QUEUE_H__
+#define __EVENT_QUEUE_H__
+
+#include <cstdint>
+#include <vector>
+#include "base_object.h"
+
+class AbstractMemory;
+
+//max number of memory objects that can schedule events
+#define MAX_EVENT_OBJECTS 64
+
+/*
+ * An event hands a packet back to the memory object that
+ * scheduled it once the packet's ready_time is reached
+ */
+struct Event {
+	AbstractMemory* target;
+	Packet* pkt;
+	uint64_t when;
+	Event* next;
+};
+
+/*
+ * Simulator-wide calendar queue (timing wheel). Each slot of the
+ * wheel holds the events of one cycle, so both scheduling and
+ * dispatching an event are O(1). Events further away than the
+ * wheel horizon wait in an overflow list until they come into range.
+ *
+ * Within a cycle, events are dispatched in the order the memory
+ * objects were added to the queue and, per object, in the order
+ * they were scheduled.
+ */
+class EventQueue {
+public:
+	EventQueue(uint32_t numSlots = 1024);
+	virtual ~EventQueue();
+
+	/*
+	 * register a memory object that schedules events; objects
+	 * added first are serviced first within a cycle (at most
+	 * MAX_EVENT_OBJECTS objects)
+	 */
+	void addObject(AbstractMemory* obj);
+
+	//schedule pkt to be serviced by target at pkt->ready_time
+	void schedule(AbstractMemory* target, Packet* pkt);
+
+	//dispatch all the events that are due at the given cycle
+	void serviceEvents(uint64_t cycle);
+
+	/*
+	 * returns the cycle of the earliest pending event, or
+	 * UINT64_MAX if nothing is scheduled
+	 */
+	uint64_t nextEventTime();
+
+	//number of scheduled events that are not dispatched yet
+	uint64_t numPending;
+
+private:
+	//per-object FIFO of the events of one cycle
+	struct EventList {
+		Event* head;
+		Event* tail;
+	};
+
+	uint32_t numSlots;
+	uint32_t numObjects;
+	//numSlots x numObjects lists, slot-major
+	std::vector<EventList> slots;
+	/*
+	 * per slot, one bit per memory object that has events in it.
+	 * Dispatch only visits these active objects, so an idle object
+	 * costs nothing no matter how many are registered
+	 */
+	std::vector<uint64_t> slotActive;
+	//one bit per slot that has events, for finding the next event
+	std::vector<uint64_t> slotMask;
+	//events beyond the wheel horizon
+	std::vector<Event*> overflow;
+	uint64_t overflowMin;
+
+	//cycle of the last serviceEvents call
+	uint64_t now;
+
+	//recycled event nodes
+	Event* freeList;
+	std::vector<Event*> chunks;
+
+	Event* allocEvent();
+	void freeEvent(Event* ev);
+	void insert(Event* ev);
+	void refillFromOverflow();
+};
+
+#endif
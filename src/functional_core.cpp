@@ -0,0 +1,314 @@
+/*
+ * Computer Architecture CSE530
+ * MIPS pipeline cycle-accurate simulator
+ * PSU
+ */
+
+#include <iostream>
+#include <cstring>
+#include <cassert>
+#include "functional_core.h"
+#include "mips.h"
+
+FunctionalCore::FunctionalCore(PipeState* pipe, BaseMemory* mem) :
+		warming(false), pipe(pipe), mem(mem), data_mem(pipe->data_mem), inst_mem(
+				pipe->inst_mem) {
+}
+
+FunctionalCore::~FunctionalCore() {
+
+}
+
+uint8_t* FunctionalCore::getMemPtr(uint32_t addr, uint32_t size,
+		bool forWrite) {
+	uint8_t* ptr = mem->translate(addr, size, forWrite);
+	if (ptr == nullptr) {
+		std::cerr << "Access across a memory page : addr : "
+				<< std::hex << addr << " " << addr + size << std::dec
+				<< "\n";
+		assert(false);
+	}
+	return ptr;
+}
+
+uint32_t FunctionalCore::readWord(uint32_t addr) {
+	uint32_t val;
+	memcpy(&val, getMemPtr(addr, 4, false), 4);
+	return val;
+}
+
+void FunctionalCore::write(uint32_t addr, uint32_t size, uint32_t value) {
+	//check the access like the main memory does
+	getMemPtr(addr, size, false);
+	data_mem->dumpWrite(addr, size, (uint8_t*) &value);
+}
+
+uint64_t FunctionalCore::run(uint64_t n) {
+	uint32_t* REGS = pipe->REGS;
+	uint64_t count;
+
+	for (count = 0; count < n && pipe->RUN_BIT; count++) {
+		uint32_t pc = pipe->PC;
+		uint32_t instruction = readWord(pc);
+		uint32_t nextPC = pc + 4;
+		if (warming)
+			inst_mem->warmAccess(pc, PacketTypeFetch);
+
+		uint32_t opcode = (instruction >> 26) & 0x3F;
+		uint32_t rs = (instruction >> 21) & 0x1F;
+		uint32_t rt = (instruction >> 16) & 0x1F;
+		uint32_t rd = (instruction >> 11) & 0x1F;
+		uint32_t shamt = (instruction >> 6) & 0x1F;
+		uint32_t funct2 = (instruction >> 0) & 0x3F;
+		uint32_t imm16 = (instruction >> 0) & 0xFFFF;
+		uint32_t se_imm16 = imm16 | ((imm16 & 0x8000) ? 0xFFFF8000 : 0);
+		uint32_t targ = (instruction & ((1UL << 26) - 1)) << 2;
+
+		uint32_t src1 = REGS[rs];
+		uint32_t src2 = REGS[rt];
+		//destination register (-1 for none) and the value written to it
+		int dst = -1;
+		uint32_t dstValue = 0;
+		//branch outcome as the execute stage reports it to the predictor
+		bool taken = false;
+		uint32_t branchDest = 0;
+
+		switch (opcode) {
+		case OP_SPECIAL:
+			/*
+			 * all "SPECIAL" insts write rd in the pipeline, the ones
+			 * that do not produce a value write 0
+			 */
+			dst = rd;
+			switch (funct2) {
+			case SUBOP_SLL:
+				dstValue = src2 << shamt;
+				break;
+			case SUBOP_SLLV:
+				dstValue = src2 << src1;
+				break;
+			case SUBOP_SRL:
+				dstValue = src2 >> shamt;
+				break;
+			case SUBOP_SRLV:
+				dstValue = src2 >> src1;
+				break;
+			case SUBOP_SRA:
+				dstValue = (int32_t) src2 >> shamt;
+				break;
+			case SUBOP_SRAV:
+				dstValue = (int32_t) src2 >> src1;
+				break;
+			case SUBOP_JR:
+			case SUBOP_JALR:
+				dstValue = pc + 4;
+				taken = true;
+				branchDest = src1;
+				break;
+			case SUBOP_SYSCALL:
+				if (REGS[2] == 0xA) {
+					//same final PC as the pipeline
+					nextPC = pc;
+					pipe->RUN_BIT = false;
+				}
+				break;
+			case SUBOP_MULT: {
+				int64_t val = (int64_t) ((int32_t) src1)
+						* (int64_t) ((int32_t) src2);
+				uint64_t uval = (uint64_t) val;
+				pipe->HI = (uval >> 32) & 0xFFFFFFFF;
+				pipe->LO = (uval >> 0) & 0xFFFFFFFF;
+			}
+				break;
+			case SUBOP_MULTU: {
+				uint64_t val = (uint64_t) src1 * (uint64_t) src2;
+				pipe->HI = (val >> 32) & 0xFFFFFFFF;
+				pipe->LO = (val >> 0) & 0xFFFFFFFF;
+			}
+				break;
+			case SUBOP_DIV:
+				if (src2 != 0) {
+					int32_t val1 = (int32_t) src1;
+					int32_t val2 = (int32_t) src2;
+					pipe->LO = val1 / val2;
+					pipe->HI = val1 % val2;
+				} else {
+					pipe->HI = pipe->LO = 0;
+				}
+				break;
+			case SUBOP_DIVU:
+				if (src2 != 0) {
+					pipe->HI = src1 % src2;
+					pipe->LO = src1 / src2;
+				} else {
+					pipe->HI = pipe->LO = 0;
+				}
+				break;
+			case SUBOP_MFHI:
+				dstValue = pipe->HI;
+				break;
+			case SUBOP_MTHI:
+				pipe->HI = src1;
+				break;
+			case SUBOP_MFLO:
+				dstValue = pipe->LO;
+				break;
+			case SUBOP_MTLO:
+				pipe->LO = src1;
+				break;
+			case SUBOP_ADD:
+			case SUBOP_ADDU:
+				dstValue = src1 + src2;
+				break;
+			case SUBOP_SUB:
+			case SUBOP_SUBU:
+				dstValue = src1 - src2;
+				break;
+			case SUBOP_AND:
+				dstValue = src1 & src2;
+				break;
+			case SUBOP_OR:
+				dstValue = src1 | src2;
+				break;
+			case SUBOP_NOR:
+				dstValue = ~(src1 | src2);
+				break;
+			case SUBOP_XOR:
+				dstValue = src1 ^ src2;
+				break;
+			case SUBOP_SLT:
+				dstValue = ((int32_t) src1 < (int32_t) src2) ? 1 : 0;
+				break;
+			case SUBOP_SLTU:
+				dstValue = (src1 < src2) ? 1 : 0;
+				break;
+			}
+			break;
+
+		case OP_BRSPEC:
+			branchDest = pc + 4 + (se_imm16 << 2);
+			switch (rt) {
+			case BROP_BLTZ:
+			case BROP_BLTZAL:
+				taken = (int32_t) src1 < 0;
+				break;
+			case BROP_BGEZ:
+			case BROP_BGEZAL:
+				taken = (int32_t) src1 >= 0;
+				break;
+			}
+			//the link register is written whether taken or not
+			if (rt == BROP_BLTZAL || rt == BROP_BGEZAL) {
+				dst = 31;
+				dstValue = pc + 4;
+			}
+			break;
+
+		case OP_JAL:
+			dst = 31;
+			dstValue = pc + 4;
+			//fallthrough
+		case OP_J:
+			taken = true;
+			branchDest = (pc & 0xF0000000) | targ;
+			break;
+
+		case OP_BEQ:
+			branchDest = pc + 4 + (se_imm16 << 2);
+			taken = src1 == src2;
+			break;
+		case OP_BNE:
+			branchDest = pc + 4 + (se_imm16 << 2);
+			taken = src1 != src2;
+			break;
+		case OP_BLEZ:
+			branchDest = pc + 4 + (se_imm16 << 2);
+			taken = (int32_t) src1 <= 0;
+			break;
+		case OP_BGTZ:
+			branchDest = pc + 4 + (se_imm16 << 2);
+			taken = (int32_t) src1 > 0;
+			break;
+
+		case OP_ADDI:
+		case OP_ADDIU:
+			dst = rt;
+			dstValue = src1 + se_imm16;
+			break;
+		case OP_SLTI:
+			dst = rt;
+			dstValue = (int32_t) src1 < (int32_t) se_imm16 ? 1 : 0;
+			break;
+		case OP_SLTIU:
+			dst = rt;
+			dstValue = (uint32_t) src1 < (uint32_t) se_imm16 ? 1 : 0;
+			break;
+		case OP_ANDI:
+			dst = rt;
+			dstValue = src1 & imm16;
+			break;
+		case OP_ORI:
+			dst = rt;
+			dstValue = src1 | imm16;
+			break;
+		case OP_XORI:
+			dst = rt;
+			dstValue = src1 ^ imm16;
+			break;
+		case OP_LUI:
+			dst = rt;
+			dstValue = imm16 << 16;
+			break;
+
+		case OP_LW:
+		case OP_LH:
+		case OP_LHU:
+		case OP_LB:
+		case OP_LBU: {
+			uint32_t addr = src1 + se_imm16;
+			//the pipeline always loads the aligned word
+			uint32_t val = readWord(addr & ~3);
+			if (warming)
+				data_mem->warmAccess(addr & ~3, PacketTypeLoad);
+			dst = rt;
+			if (opcode == OP_LW) {
+				dstValue = val;
+			} else if (opcode == OP_LH || opcode == OP_LHU) {
+				if (addr & 2)
+					val = (val >> 16) & 0xFFFF;
+				else
+					val = val & 0xFFFF;
+				if (opcode == OP_LH)
+					val |= (val & 0x8000) ? 0xFFFF8000 : 0;
+				dstValue = val;
+			} else {
+				val = (val >> ((addr & 3) * 8)) & 0xFF;
+				if (opcode == OP_LB)
+					val |= (val & 0x80) ? 0xFFFFFF80 : 0;
+				dstValue = val;
+			}
+			break;
+		}
+
+		case OP_SB:
+			write(src1 + se_imm16, 1, src2 & 0xFF);
+			break;
+		case OP_SH:
+			write(src1 + se_imm16, 2, src2 & 0xFFFF);
+			break;
+		case OP_SW:
+			write(src1 + se_imm16, 4, src2);
+			break;
+		}
+
+		if (dst > 0)
+			REGS[dst] = dstValue;
+		if (taken)
+			nextPC = branchDest;
+		//the pipeline updates the predictor for every executed op
+		if (warming)
+			pipe->BP->update(pc, taken, branchDest);
+		pipe->PC = nextPC;
+	}
+	return count;
+}
@@ -0,0 +1,58 @@
+/*
+ * Computer Architecture CSE530
+ * MIPS pipeline cycle-accurate simulator
+ * PSU
+ */
+
+#ifndef __FUNCTIONAL_CORE_H__
+#define __FUNCTIONAL_CORE_H__
+
+#include <cstdint>
+#include "pipe.h"
+#include "base_memory.h"
+
+/*
+ * Functional (ISA-level) interpreter used for fast-forwarding. It
+ * executes instructions one at a time directly on the architectural
+ * state of the PipeState (REGS, HI, LO and PC) and on BaseMemory,
+ * without any pipeline or cache timing. Its semantics match the ones
+ * of the five-stage pipeline.
+ *
+ * The caches are write-through, so once the pipeline is drained the
+ * main memory holds the latest data and loads and fetches are read
+ * from it directly. Stores are written through data_mem so that the
+ * cached copies stay coherent.
+ *
+ * With warming enabled, fetches and loads also update the caches and
+ * every instruction updates the branch predictor, as the pipeline
+ * would on the correct path (functional warming for sampling).
+ */
+class FunctionalCore {
+public:
+	FunctionalCore(PipeState* pipe, BaseMemory* mem);
+	virtual ~FunctionalCore();
+
+	//update the caches and the branch predictor while executing
+	bool warming;
+
+	/*
+	 * execute up to n instructions, stopping early on the exit
+	 * syscall (which clears RUN_BIT). Returns the number of
+	 * instructions executed
+	 */
+	uint64_t run(uint64_t n);
+
+private:
+	PipeState* pipe;
+	BaseMemory* mem;
+	AbstractMemory* data_mem;
+	AbstractMemory* inst_mem;
+
+	//returns a host pointer to [addr, addr+size) of the main memory
+	uint8_t* getMemPtr(uint32_t addr, uint32_t size, bool forWrite);
+
+	uint32_t readWord(uint32_t addr);
+	void write(uint32_t addr, uint32_t size, uint32_t value);
+};
+
+#endif
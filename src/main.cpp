@@ -10,284 +10,320 @@
 #include <cstdlib>
 #include <cstring>
 #include <cstdint>
-#include "config_reader.h"
-#include "simulator.h"
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "json/json.h"
+#include "commands.h"
+#include "batch_runner.h"
+#include "sweep.h"
+#include "result_cache.h"
 #include "util.h"
 
 /***************************************************************/
-/* Simulator.                                                  */
+/*                                                             */
+/* Procedure : runBatch                                        */
+/*                                                             */
+/* Purpose   : Run the simulations of a job file in parallel   */
+/*                                                             */
 /***************************************************************/
-Simulator * simulator;
+int runBatch(char* job_file, uint32_t num_threads) {
+	BatchRunner runner(num_threads);
+	if (!runner.readJobFile(job_file))
+		return 1;
+	uint32_t failed = runner.run();
+	if (failed) {
+		printf("Error: %u jobs failed\n", failed);
+		return 1;
+	}
+	return 0;
+}
 
 /***************************************************************/
 /*                                                             */
-/* Procedure: writeProgramToMem                                */
+/* Procedure : runSweep                                        */
 /*                                                             */
-/* Purpose: write the program to the memory                    */
+/* Purpose   : Run a design-space sweep and write its CSV      */
 /*                                                             */
 /***************************************************************/
-
-void writeProgramToMem(uint32_t address, uint32_t value) {
-	int i;
-	for (i = 0; i < MEM_NREGIONS; i++) {
-		mem_region_t* region = &(simulator->main_memory->MEM_REGIONS[i]);
-		if (address >= region->start
-				&& address < (region->start + region->size)) {
-			uint32_t offset = address - region->start;
-			region->mem[offset + 3] = (value >> 24) & 0xFF;
-			region->mem[offset + 2] = (value >> 16) & 0xFF;
-			region->mem[offset + 1] = (value >> 8) & 0xFF;
-			region->mem[offset + 0] = (value >> 0) & 0xFF;
-			return;
-		}
+int runSweep(char* sweep_file, uint32_t num_threads) {
+	Sweep sweep;
+	if (!sweep.readSweepFile(sweep_file))
+		return 1;
+	uint32_t failed = sweep.run(num_threads);
+	if (failed) {
+		printf("Error: %u runs failed\n", failed);
+		return 1;
 	}
+	return 0;
 }
 
 /***************************************************************/
 /*                                                             */
-/* Procedure: getMemHrchyInfo                                  */
+/* Procedure : runCached                                       */
 /*                                                             */
-/* Purpose: Read memory hierarchy configs                      */
+/* Purpose   : Run the commands of stdin, or replay the output */
+/*             recorded for the same simulation                */
 /*                                                             */
 /***************************************************************/
-MemHrchyInfo* getMemHrchyInfo(char* config_file) {
-	FILE * config;
-	int ii;
-	char line[100];
-	config = fopen(config_file, "r");
-	assert(config != NULL && "Could not open config file");
-	ii = 0;
-	std::string str;
-	while (fscanf(config, "%s\n", line) != EOF) {
-		str.append(line);
+int runCached(MemHrchyInfo* info, char* program_files[], int num_prog_files,
+		const char* cache_dir) {
+	//the programs are keyed by their files, whatever their format
+	std::vector<std::string> programs(num_prog_files);
+	for (int i = 0; i < num_prog_files; i++) {
+		std::ifstream file(program_files[i], std::ios::binary);
+		if (!file) {
+			printf("Error: Can't open program file %s\n", program_files[i]);
+			return -1;
+		}
+		std::ostringstream bytes;
+		bytes << file.rdbuf();
+		programs[i] = bytes.str();
 	}
-	fclose(config);
-	ConfigReader msg;
-	msg.setJson(str);
-	std::cerr << "Config file is read successfully\n";
-	MemHrchyInfo * info = new MemHrchyInfo;
-
-	if(msg.getValue("cache_size_l1") != Json::nullValue)
-		info->cache_size_l1 = msg.getValue("cache_size_l1").asInt();
-	else
-		std::cerr << "cache_size_l1 is not defined in config.json, using default value : " << info->cache_size_l1 << "\n";
-
-	if(msg.getValue("cache_assoc_l1") != Json::nullValue)
-		info->cache_assoc_l1 = msg.getValue("cache_assoc_l1").asInt();
-	else
-		std::cerr << "cache_assoc_l1 is not defined in config.json, using default value : " << info->cache_assoc_l1 << "\n";
-
-	if(msg.getValue("cache_size_l2") != Json::nullValue)
-		info->cache_size_l2 = msg.getValue("cache_size_l2").asInt();
-	else
-		std::cerr << "cache_size_l2 is not defined in config.json, using default value : " << info->cache_size_l2 << "\n";
-
-	if(msg.getValue("cache_assoc_l2") != Json::nullValue)
-		info->cache_assoc_l2 = msg.getValue("cache_assoc_l2").asInt();
-	else
-		std::cerr << "cache_assoc_l2 is not defined in config.json, using default value : " << info->cache_assoc_l2 << "\n";
-
-	if(msg.getValue("cache_blk_size") != Json::nullValue)
-		info->cache_blk_size = msg.getValue("cache_blk_size").asInt();
-	else
-		std::cerr << "cache_blk_size is not defined in config.json, using default value : " << info->cache_blk_size << "\n";
-
-	if(msg.getValue("repl_policy_l1d") != Json::nullValue)
-		info->repl_policy_l1d = static_cast<ReplacementPolicy>(msg.getValue("repl_policy_l1d").asInt());
-	else
-		std::cerr << "repl_policy_l1d is not defined in config.json, using default value : " << info->repl_policy_l1d << "\n";
-
-	if(msg.getValue("repl_policy_l1i") != Json::nullValue)
-		info->repl_policy_l1i = static_cast<ReplacementPolicy>(msg.getValue("repl_policy_l1i").asInt());
-	else
-		std::cerr << "repl_policy_l1i is not defined in config.json, using default value : " << info->repl_policy_l1i << "\n";
-
-	if(msg.getValue("repl_policy_l2") != Json::nullValue)
-		info->repl_policy_l2 = static_cast<ReplacementPolicy>(msg.getValue("repl_policy_l2").asInt());
-	else
-		std::cerr << "repl_policy_l2 is not defined in config.json, using default value : " << info->repl_policy_l2 << "\n";
-
-	if(msg.getValue("access_delay_l1") != Json::nullValue)
-		info->access_delay_l1 = msg.getValue("access_delay_l1").asInt();
-	else
-		std::cerr << "access_delay_l1 is not defined in config.json, using default value : " << info->access_delay_l1 << "\n";
-
-	if(msg.getValue("access_delay_l2") != Json::nullValue)
-		info->access_delay_l2 = msg.getValue("access_delay_l2").asInt();
-	else
-		std::cerr << "access_delay_l2 is not defined in config.json, using default value : " << info->access_delay_l2 << "\n";
-
-	if(msg.getValue("memDelay") != Json::nullValue)
-		info->memDelay = msg.getValue("memDelay").asInt();
-	else
-		std::cerr << "memDelay is not defined in config.json, using default value : " << info->memDelay << "\n";
 
-	if(msg.getValue("debugMemory") != Json::nullValue)
-		DEBUG_MEMORY = msg.getValue("debugMemory").asBool();
-	if(msg.getValue("debugPipe") != Json::nullValue)
-		DEBUG_PIPE = msg.getValue("debugPipe").asBool();
-	if(msg.getValue("debugCache") != Json::nullValue)
-		DEBUG_CACHE = msg.getValue("debugCache").asBool();
-	if(msg.getValue("debugPrefetch") != Json::nullValue)
-		DEBUG_PREFETCH = msg.getValue("debugPrefetch").asBool();
-	if(msg.getValue("debugAll") != Json::nullValue && msg.getValue("debugAll").asBool())
-		DEBUG_MEMORY = DEBUG_PIPE = DEBUG_CACHE = DEBUG_PREFETCH = true;
-	if(msg.getValue("traceMemory") != Json::nullValue)
-		TRACE_MEMORY = msg.getValue("traceMemory").asBool();
+	//the whole script is part of the key
+	std::string script;
+	char buffer[4096];
+	size_t n;
+	while ((n = fread(buffer, 1, sizeof(buffer), stdin)) > 0)
+		script.append(buffer, n);
+
+	ResultCache cache(cache_dir);
+	cache.setKey(info, programs, script);
+	bool cacheable = ResultCache::isCacheable(script);
+	std::string output;
+	if (cacheable && cache.lookup(output)) {
+		fwrite(output.data(), 1, output.size(), stdout);
+		return 0;
+	}
 
-	return info;
+	char* outBuffer;
+	size_t outSize;
+	FILE* out = open_memstream(&outBuffer, &outSize);
+	FILE* in = fmemopen((void*) script.data(), script.size(), "r");
+	Simulator* simulator = new Simulator(info, out);
+	//a failed run is not recorded, the next one reports it again
+	bool failed = !initialize(simulator, program_files, num_prog_files);
+	while (!failed && in && getCommand(simulator, in))
+		;
+	failed = failed || simulator->failed;
+	delete simulator;
+	if (in)
+		fclose(in);
+	fclose(out);
+
+	output.assign(outBuffer, outSize);
+	free(outBuffer);
+	fwrite(output.data(), 1, output.size(), stdout);
+	if (failed)
+		return 1;
+	if (cacheable && !cache.store(output))
+		std::cerr << "Could not store the result in " << cache_dir << "\n";
+	return 0;
 }
 
+//what a command line flag of a headless run does, in flag order
+enum HeadlessActionType {
+	ActionGo, ActionRun, ActionRegs, ActionMem, ActionScript
+};
+
+struct HeadlessAction {
+	HeadlessActionType type;
+	//cycles of --run
+	int cycles;
+	//range of --mem
+	uint32_t start, stop;
+	//file of --script
+	const char* filename;
+};
+
 /***************************************************************/
 /*                                                             */
-/* Procedure : help                                            */
+/* Procedure : parseHeadlessFlag                               */
 /*                                                             */
-/* Purpose   : Print out a list of commands                    */
+/* Purpose   : Parse the headless flag at argv[i] and move i   */
+/*             past it. Returns false if it is not one         */
 /*                                                             */
 /***************************************************************/
-void help() {
-	printf("----------------MIPS ISIM Help-----------------------\n");
-	printf("go                     -  run program to completion         \n");
-	printf("run n                  -  execute program for n instructions\n");
-	printf(
-			"registerDump                  -  dump architectural registers      \n");
-	printf("memDump low high         -  dump memory from low to high      \n");
-	printf("input reg_no reg_value - set GPR reg_no to reg_value  \n");
-	printf("?                      -  display this help menu            \n");
-	printf("quit                   -  exit the program                  \n\n");
+bool parseHeadlessFlag(int argc, char* argv[], int& i,
+		std::vector<HeadlessAction>& actions, char*& stats_file) {
+	std::string flag = argv[i];
+	HeadlessAction action = HeadlessAction();
+	if (flag == "--go" || flag == "--regs") {
+		action.type = flag == "--go" ? ActionGo : ActionRegs;
+		actions.push_back(action);
+		i++;
+		return true;
+	}
+	if (i + 1 >= argc)
+		return false;
+	char* arg = argv[i + 1];
+	char* end;
+	if (flag == "--run") {
+		action.type = ActionRun;
+		action.cycles = strtol(arg, &end, 0);
+		if (*end != '\0' || action.cycles <= 0)
+			return false;
+	} else if (flag == "--mem") {
+		action.type = ActionMem;
+		action.start = strtoul(arg, &end, 0);
+		if (*end != ':')
+			return false;
+		action.stop = strtoul(end + 1, &end, 0);
+		if (*end != '\0')
+			return false;
+	} else if (flag == "--script") {
+		action.type = ActionScript;
+		action.filename = arg;
+	} else if (flag == "--stats-json") {
+		stats_file = arg;
+		i += 2;
+		return true;
+	} else {
+		return false;
+	}
+	actions.push_back(action);
+	i += 2;
+	return true;
 }
 
 /***************************************************************/
 /*                                                             */
-/* Procedure : getCommand                                     */
+/* Procedure : writeStatsJson                                  */
 /*                                                             */
-/* Purpose   : Read a command from standard input.             */
+/* Purpose   : Write the final state, the statistics and the   */
+/*             --mem ranges of a headless run as JSON          */
 /*                                                             */
 /***************************************************************/
-bool getCommand() {
-	char buffer[20];
-	int start, stop, cycles;
-	int register_no, register_value;
+bool writeStatsJson(Simulator* simulator, const char* config_file,
+		char* program_files[], int num_prog_files,
+		const std::vector<HeadlessAction>& actions, const char* stats_file) {
+	PipeState* pipe = simulator->pipe;
+	Json::Value root;
+	root["config"] = config_file;
+	root["programs"] = Json::Value(Json::arrayValue);
+	for (int i = 0; i < num_prog_files; i++)
+		root["programs"].append(program_files[i]);
+	root["halted"] = !pipe->RUN_BIT;
+	root["cycles"] = pipe->stat_cycles;
+	root["fetchedInstr"] = pipe->stat_inst_fetch;
+	root["retiredInstr"] = pipe->stat_inst_retire;
+	root["ipc"] = pipe->stat_cycles ?
+			(double) pipe->stat_inst_retire / pipe->stat_cycles : 0.0;
+	root["flushes"] = pipe->stat_squash;
+
+	root["pc"] = pipe->PC;
+	for (int i = 0; i < 32; i++)
+		root["regs"].append(pipe->REGS[i]);
+	root["hi"] = pipe->HI;
+	root["lo"] = pipe->LO;
+
+	Cache* caches[] = { simulator->l1ICache, simulator->l1DCache,
+			simulator->l2Cache };
+	const char* names[] = { "l1i", "l1d", "l2" };
+	for (int i = 0; i < 3; i++) {
+		root["caches"][names[i]]["hits"] = (Json::UInt64) caches[i]->stat_hits;
+		root["caches"][names[i]]["misses"] =
+				(Json::UInt64) caches[i]->stat_misses;
+	}
 
-	printf("SIM> ");
+	//the words of the --mem ranges as the program sees them at the end
+	root["memory"] = Json::Value(Json::arrayValue);
+	for (uint32_t i = 0; i < actions.size(); i++) {
+		if (actions[i].type != ActionMem)
+			continue;
+		const HeadlessAction& mem = actions[i];
+		uint32_t len = mem.stop > mem.start ?
+				((uint64_t) mem.stop - mem.start + 3) & ~3 : 0;
+		std::vector<uint8_t> data;
+		simulator->readMemRange(mem.start, len, data);
+		Json::Value range;
+		range["start"] = mem.start;
+		range["stop"] = mem.stop;
+		range["words"] = Json::Value(Json::arrayValue);
+		for (uint32_t j = 0; j < len; j += 4) {
+			uint32_t word;
+			memcpy(&word, &data[j], 4);
+			range["words"].append(word);
+		}
+		root["memory"].append(range);
+	}
 
-	//End of commands
-	if (scanf("%s", buffer) == EOF)
+	std::ofstream file(stats_file);
+	if (!file)
 		return false;
+	Json::StreamWriterBuilder builder;
+	builder["indentation"] = "\t";
+	std::unique_ptr<Json::StreamWriter> writer(builder.newStreamWriter());
+	writer->write(root, &file);
+	file << "\n";
+	file.close();
+	return !file.fail();
+}
 
-	printf("\n");
-
-	switch (buffer[0]) {
-	case 'G':
-	case 'g':
-		simulator->go();
-		break;
+/***************************************************************/
+/*                                                             */
+/* Procedure : runHeadless                                     */
+/*                                                             */
+/* Purpose   : Run the actions of the command line flags       */
+/*             without reading commands from stdin             */
+/*                                                             */
+/***************************************************************/
+int runHeadless(MemHrchyInfo* info, const char* config_file,
+		char* program_files[], int num_prog_files,
+		const std::vector<HeadlessAction>& actions, const char* stats_file) {
+	//nobody reads the output interactively
+	setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+
+	Simulator* simulator = new Simulator(info);
+	if (!initialize(simulator, program_files, num_prog_files)) {
+		delete simulator;
+		return 1;
+	}
 
-	case 'M':
-	case 'm':
-		if (scanf("%i %i", &start, &stop) != 2)
+	int ret = 0;
+	for (uint32_t i = 0; i < actions.size() && ret == 0; i++) {
+		const HeadlessAction& action = actions[i];
+		switch (action.type) {
+		case ActionGo:
+			simulator->go();
 			break;
-
-		simulator->memDump(start, stop);
-		break;
-
-	case '?':
-		help();
-		break;
-	case 'Q':
-	case 'q':
-		printf("Bye.\n");
-		return false;
-
-	case 'R':
-	case 'r':
-		if (buffer[1] == 'd' || buffer[1] == 'D')
+		case ActionRun:
+			simulator->run(action.cycles);
+			break;
+		case ActionRegs:
 			simulator->registerDump();
-		else {
-			if (scanf("%d", &cycles) != 1)
-				break;
-			simulator->run(cycles);
-		}
-		break;
-
-	case 'I':
-	case 'i':
-		if (scanf("%i %i", &register_no, &register_value) != 2)
 			break;
-
-		printf("%i %i\n", register_no, register_value);
-		simulator->pipe->REGS[register_no] = register_value;
-		break;
-
-	case 'H':
-	case 'h':
-		if (scanf("%i", &register_value) != 1)
+		case ActionMem:
+			simulator->memDump(action.start, action.stop);
 			break;
-
-		simulator->pipe->HI = register_value;
-		break;
-
-	case 'L':
-	case 'l':
-		if (scanf("%i", &register_value) != 1)
+		case ActionScript: {
+			FILE* script = fopen(action.filename, "r");
+			if (script == NULL) {
+				printf("Error: Can't open script file %s\n", action.filename);
+				ret = 1;
+				break;
+			}
+			while (getCommand(simulator, script))
+				;
+			fclose(script);
+			if (simulator->failed)
+				ret = 1;
 			break;
-
-		simulator->pipe->LO = register_value;
-		break;
-
-	default:
-		printf("Invalid Command\n");
-		break;
-	}
-	return true;
-}
-
-/**************************************************************/
-/*                                                            */
-/* Procedure : loadProgram                                   */
-/*                                                            */
-/* Purpose   : Load program and service routines into mem.    */
-/*                                                            */
-/**************************************************************/
-void loadProgram(char *program_filename) {
-	FILE * prog;
-	int ii, word;
-
-	/* Open program file. */
-	prog = fopen(program_filename, "r");
-	if (prog == NULL) {
-		printf("Error: Can't open program file %s\n", program_filename);
-		exit(-1);
-	}
-
-	/* Read in the program. */
-	ii = 0;
-	while (fscanf(prog, "%x\n", &word) != EOF) {
-		writeProgramToMem(MEM_TEXT_START + ii, word);
-		ii += 4;
+		}
+		}
 	}
 
-	fclose(prog);
-
-	printf("Read %d words from program into memory.\n\n", ii / 4);
-}
-
-/************************************************************/
-/*                                                          */
-/* Procedure : initialize                                   */
-/*                                                          */
-/* Purpose   : Load machine language program                */
-/*             and set up initial state of the machine.     */
-/*                                                          */
-/************************************************************/
-void initialize(char *program_filename, int num_prog_files) {
-	int i;
-	for (i = 0; i < num_prog_files; i++) {
-		loadProgram(program_filename);
-		while (*program_filename++ != '\0')
-			;
+	if (ret == 0 && stats_file
+			&& !writeStatsJson(simulator, config_file, program_files,
+					num_prog_files, actions, stats_file)) {
+		printf("Error: Can't write stats file %s\n", stats_file);
+		ret = 1;
 	}
-	simulator->pipe->RUN_BIT = true;
+	delete simulator;
+	return ret;
 }
 
 /***************************************************************/
@@ -297,18 +333,61 @@ void initialize(char *program_filename, int num_prog_files) {
 /***************************************************************/
 int main(int argc, char *argv[]) {
 
+	if (argc >= 3 && strcmp(argv[1], "--batch") == 0)
+		return runBatch(argv[2], argc > 3 ? atoi(argv[3]) : 0);
+	if (argc >= 3 && strcmp(argv[1], "--sweep") == 0)
+		return runSweep(argv[2], argc > 3 ? atoi(argv[3]) : 0);
+
+	//index of the config file in argv
+	int first = 1;
+	char* cache_dir = NULL;
+	if (argc >= 3 && strcmp(argv[1], "--result-cache") == 0) {
+		cache_dir = argv[2];
+		first = 3;
+	}
+
+	//flags of a headless run
+	std::vector<HeadlessAction> actions;
+	char* stats_file = NULL;
+	while (!cache_dir && first < argc && strncmp(argv[first], "--", 2) == 0) {
+		if (!parseHeadlessFlag(argc, argv, first, actions, stats_file))
+			break;
+	}
+	bool headless = !actions.empty() || stats_file;
+
 	/* Error Checking */
-	if (argc < 3) {
+	if (argc < first + 2 || strncmp(argv[first], "--", 2) == 0) {
 		printf("Error: usage: %s <config_file> <program_file_1> <program_file_2> ...\n",
 				argv[0]);
+		printf("       %s --batch <job_file> [num_threads]\n", argv[0]);
+		printf("       %s --sweep <sweep_file> [num_threads]\n", argv[0]);
+		printf("       %s --result-cache <dir> <config_file> <program_file_1> ...\n",
+				argv[0]);
+		printf("       %s [--go] [--run n] [--regs] [--mem lo:hi] [--script file]\n",
+				argv[0]);
+		printf("           [--stats-json file] <config_file> <program_file_1> ...\n");
 		exit(1);
 	}
-	MemHrchyInfo* info = getMemHrchyInfo(argv[1]);
+	MemHrchyInfo* info = getMemHrchyInfo(argv[first]);
 	printf("Simulator...\n\n");
 
-	simulator = new Simulator(info);
-	initialize(argv[2], argc - 2);
-	while (getCommand())
+	if (cache_dir) {
+		int ret = runCached(info, argv + first + 1, argc - first - 1, cache_dir);
+		delete (info);
+		return ret;
+	}
+
+	if (headless) {
+		int ret = runHeadless(info, argv[first], argv + first + 1,
+				argc - first - 1, actions, stats_file);
+		delete (info);
+		return ret;
+	}
+
+	Simulator* simulator = new Simulator(info);
+	if (!initialize(simulator, argv + first + 1, argc - first - 1))
+		exit(-1);
+	while (getCommand(simulator, stdin))
 		;
 
 	delete (simulator);
@@ -0,0 +1,29 @@
+/*
+ * Computer Architecture CSE530
+ * MIPS pipeline cycle-accurate simulator
+ * PSU
+ */
+
+#include "packet_pool.h"
+
+//number of packet slots allocated at once
+#define PACKET_SLAB_SIZE 64
+
+PacketPool::PacketPool() :
+		numLive(0), peakLive(0), numSlots(0) {
+	slotSize = sizeof(Packet);
+}
+
+PacketPool::~PacketPool() {
+	for (uint32_t i = 0; i < slabs.size(); i++)
+		delete[] slabs[i];
+}
+
+void PacketPool::grow() {
+	uint8_t* slab = new uint8_t[(uint64_t) slotSize * PACKET_SLAB_SIZE];
+	slabs.push_back(slab);
+	//hand out the slots in address order
+	for (int i = PACKET_SLAB_SIZE - 1; i >= 0; i--)
+		freeSlots.push_back(slab + (uint64_t) i * slotSize);
+	numSlots += PACKET_SLAB_SIZE;
+}
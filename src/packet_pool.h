@@ -0,0 +1,71 @@
+/*
+ * Computer Architecture CSE530
+ * MIPS pipeline cycle-accurate simulator
+ * PSU
+ */
+
+#ifndef __PACKET_POOL_H__
+#define __PACKET_POOL_H__
+
+#include <cstdint>
+#include <cassert>
+#include <new>
+#include <vector>
+#include "base_object.h"
+
+/*
+ * Slab allocator of the memory packets of one simulator. The request
+ * data is inline in the Packet and fills only carry a view of the
+ * source block, so a packet needs no allocation of its own. Freed
+ * slots are recycled and never given back until the pool is destroyed.
+ *
+ * Ownership: whoever allocates a packet owns it until the packet is
+ * accepted by a sendReq. From then on the memory hierarchy owns it
+ * and hands it back with recvResp to the original sender, which
+ * frees it. A packet that is never accepted is freed by its sender
+ */
+class PacketPool {
+public:
+	PacketPool();
+	virtual ~PacketPool();
+
+	Packet* alloc(bool isReq, bool isWrite, PacketSrcType type, uint32_t addr,
+			uint32_t size, uint32_t ready_time) {
+		assert(size <= PACKET_INLINE_DATA_SIZE && "packet data is too large");
+		if (freeSlots.empty())
+			grow();
+		uint8_t* slot = freeSlots.back();
+		freeSlots.pop_back();
+		Packet* pkt = new (slot) Packet(isReq, isWrite, type, addr, size,
+				ready_time);
+		numLive++;
+		if (numLive > peakLive)
+			peakLive = numLive;
+		return pkt;
+	}
+
+	void free(Packet* pkt) {
+		assert(numLive > 0 && "packet freed twice");
+		numLive--;
+		freeSlots.push_back((uint8_t*) pkt);
+	}
+
+	//packets currently allocated
+	uint64_t numLive;
+	//max number of packets allocated at the same time
+	uint64_t peakLive;
+	//slots carved out of the slabs so far
+	uint64_t numSlots;
+
+private:
+	//size of a slot
+	uint32_t slotSize;
+
+	std::vector<uint8_t*> freeSlots;
+	std::vector<uint8_t*> slabs;
+
+	//allocate a new slab and add its slots to freeSlots
+	void grow();
+};
+
+#endif
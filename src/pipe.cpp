@@ -9,6 +9,8 @@
 #include "abstract_memory.h"
 #include "static_nt_branch_predictor.h"
 #include "dynamic_branch_predictor.h"
+#include "packet_pool.h"
+#include "cache.h"
 #include <cstdio>
 #include <iostream>
 #include <cstring>
@@ -17,23 +19,23 @@
 #include "util.h"
 
 /* debug */
-void printOp(Pipe_Op *op) {
+void printOp(FILE* out, Pipe_Op *op) {
 	if (op)
-		printf(
+		fprintf(out,
 				"OP (PC=%08x inst=%08x) src1=R%d (%08x) src2=R%d (%08x) dst=R%d valid %d (%08x) br=%d taken=%d dest=%08x mem=%d addr=%08x\n",
 				op->pc, op->instruction, op->reg_src1, op->reg_src1_value,
 				op->reg_src2, op->reg_src2_value, op->reg_dst,
 				op->reg_dst_value_ready, op->reg_dst_value, op->is_branch,
 				op->branch_taken, op->branch_dest, op->is_mem, op->mem_addr);
 	else
-		printf("(null)\n");
+		fprintf(out, "(null)\n");
 }
 
-PipeState::PipeState() :
-		fetch_op(nullptr), decode_op(nullptr), execute_op(nullptr), mem_op(
+PipeState::PipeState(SimContext* ctx, MemHrchyInfo* info) :
+		BaseObject(ctx), fetch_op(nullptr), decode_op(nullptr), execute_op(nullptr), mem_op(
 				nullptr), wb_op(nullptr), data_mem(nullptr), inst_mem(nullptr), HI(
 				0), LO(0), branch_recover(0), branch_dest(0), branch_flush(0), RUN_BIT(
-				true), stat_cycles(0), stat_inst_retire(0), stat_inst_fetch(0), stat_squash(
+				true), drainMode(false), stat_cycles(0), stat_inst_retire(0), stat_inst_fetch(0), stat_squash(
 				0) {
 	//initialize the register file
 	for (int i = 0; i < 32; i++) {
@@ -42,35 +44,37 @@ PipeState::PipeState() :
 	//initialize PC
 	PC = 0x00400000;
 	//initialize dynamic branch predictor
-	BP = new DynamicBranchPredictor();
+	BP = new DynamicBranchPredictor(info->bht_entries, info->bht_entry_width,
+			info->pht_width, info->btb_size);
 }
 
 PipeState::~PipeState() {
 	if (fetch_op)
-		free(fetch_op);
+		opPool.release(fetch_op);
 	if (decode_op)
-		free(decode_op);
+		opPool.release(decode_op);
 	if (execute_op)
-		free(execute_op);
+		opPool.release(execute_op);
 	if (mem_op)
-		free(mem_op);
+		opPool.release(mem_op);
 	if (wb_op)
-		free(wb_op);
+		opPool.release(wb_op);
 	delete BP;
 }
 
 void PipeState::pipeCycle() {
-	if (DEBUG_PIPE) {
-		printf("\n\n----\nCycle : %lu\nPIPELINE:\n", currCycle);
-		printf("DECODE: ");
-		printOp(decode_op);
-		printf("EXEC : ");
-		printOp(execute_op);
-		printf("MEM  : ");
-		printOp(mem_op);
-		printf("WB   : ");
-		printOp(wb_op);
-		printf("\n");
+	if (ctx->DEBUG_PIPE) {
+		FILE* out = ctx->out;
+		fprintf(out, "\n\n----\nCycle : %lu\nPIPELINE:\n", ctx->currCycle);
+		fprintf(out, "DECODE: ");
+		printOp(out, decode_op);
+		fprintf(out, "EXEC : ");
+		printOp(out, execute_op);
+		fprintf(out, "MEM  : ");
+		printOp(out, mem_op);
+		fprintf(out, "WB   : ");
+		printOp(out, wb_op);
+		fprintf(out, "\n");
 	}
 
 	pipeStageWb();
@@ -89,33 +93,38 @@ void PipeState::pipeCycle() {
 		PC = branch_dest;
 
 		if (branch_flush >= 1) {
+			//a fetch packet that was never accepted is still owned by the op
+			if (fetch_op && !fetch_op->isFetchIssued)
+				ctx->packets->free(fetch_op->instFetchPkt);
 			if (fetch_op)
-				free(fetch_op);
+				opPool.release(fetch_op);
 			fetch_op = nullptr;
 		}
 
 		if (branch_flush >= 2) {
 			if (decode_op)
-				free(decode_op);
+				opPool.release(decode_op);
 			decode_op = nullptr;
 		}
 
 		if (branch_flush >= 3) {
 			if (execute_op)
-				free(execute_op);
+				opPool.release(execute_op);
 			execute_op = nullptr;
 		}
 
 		if (branch_flush >= 4) {
+			if (mem_op && mem_op->memTried && mem_op->waitOnPktIssue)
+				ctx->packets->free(mem_op->memPkt);
 			if (mem_op)
-				free(mem_op);
+				opPool.release(mem_op);
 
 			mem_op = nullptr;
 		}
 
 		if (branch_flush >= 5) {
 			if (wb_op)
-				free(wb_op);
+				opPool.release(wb_op);
 			wb_op = nullptr;
 		}
 
@@ -139,6 +148,96 @@ void PipeState::pipeRecover(int flush, uint32_t dest) {
 	branch_dest = dest;
 }
 
+bool PipeState::isStalledOnMemory() {
+	//write-back retires its op unconditionally
+	if (wb_op)
+		return false;
+
+	//memory stage only waits once its packet has been accepted
+	if (mem_op
+			&& !(mem_op->is_mem && mem_op->memTried && !mem_op->waitOnPktIssue
+					&& !mem_op->readyForNextStage))
+		return false;
+
+	//execute either proceeds into an empty memory stage or counts down a stall
+	if (execute_op && (mem_op == NULL || execute_op->stall > 0))
+		return false;
+
+	//decode proceeds whenever execute is free
+	if (decode_op && execute_op == NULL)
+		return false;
+
+	//fetch either issues a new op or retries/finishes the outstanding one
+	if (decode_op == NULL
+			&& !(fetch_op && fetch_op->isFetchIssued
+					&& !fetch_op->readyForNextStage))
+		return false;
+
+	return true;
+}
+
+//in the static hierarchy both memories of the core are L1 caches
+inline bool PipeState::sendMem(AbstractMemory* mem, Packet* pkt) {
+	if (ctx->staticHierarchy)
+		return static_cast<Cache*>(mem)->sendReq(pkt);
+	return mem->sendReq(pkt);
+}
+
+bool PipeState::isDrained() {
+	if (decode_op || execute_op || mem_op || wb_op)
+		return false;
+	//wait for an issued fetch so that no stale response is in flight
+	return fetch_op == nullptr || !fetch_op->isFetchIssued
+			|| fetch_op->readyForNextStage;
+}
+
+void PipeState::squashFetch() {
+	if (fetch_op == nullptr)
+		return;
+	//a packet that was never accepted is still owned by the op
+	if (!fetch_op->isFetchIssued)
+		ctx->packets->free(fetch_op->instFetchPkt);
+	PC = fetch_op->pc;
+	opPool.release(fetch_op);
+	fetch_op = nullptr;
+}
+
+void PipeState::serialize(CheckpointOut& cp) {
+	assert(!fetch_op && !decode_op && !execute_op && !mem_op && !wb_op
+			&& "the pipeline must be drained");
+	cp.write(REGS);
+	cp.write(HI);
+	cp.write(LO);
+	cp.write(PC);
+	cp.write(branch_recover);
+	cp.write(branch_dest);
+	cp.write(branch_flush);
+	cp.write(RUN_BIT);
+	cp.write(stat_cycles);
+	cp.write(stat_inst_retire);
+	cp.write(stat_inst_fetch);
+	cp.write(stat_squash);
+	BP->serialize(cp);
+}
+
+void PipeState::unserialize(CheckpointIn& cp) {
+	assert(!fetch_op && !decode_op && !execute_op && !mem_op && !wb_op
+			&& "the pipeline must be drained");
+	cp.read(REGS);
+	cp.read(HI);
+	cp.read(LO);
+	cp.read(PC);
+	cp.read(branch_recover);
+	cp.read(branch_dest);
+	cp.read(branch_flush);
+	cp.read(RUN_BIT);
+	cp.read(stat_cycles);
+	cp.read(stat_inst_retire);
+	cp.read(stat_inst_fetch);
+	cp.read(stat_squash);
+	BP->unserialize(cp);
+}
+
 void PipeState::pipeStageWb() {
 	//if there is no instruction in this pipeline stage, we are done
 	if (!wb_op)
@@ -162,7 +261,7 @@ void PipeState::pipeStageWb() {
 	}
 
 	//free the op
-	free(op);
+	opPool.release(op);
 	stat_inst_retire++;
 }
 
@@ -183,7 +282,7 @@ void PipeState::pipeStageMem() {
 		}
 		if (op->memTried == true) {
 			if (op->waitOnPktIssue) {
-				op->waitOnPktIssue = !(data_mem->sendReq(op->memPkt));
+				op->waitOnPktIssue = !(sendMem(data_mem, op->memPkt));
 				return;
 			}
 			if (op->readyForNextStage == false)
@@ -207,38 +306,37 @@ void PipeState::pipeStageMem() {
 	case OP_LHU:
 	case OP_LB:
 	case OP_LBU: {
-		uint8_t* data = new uint8_t[4];
-		op->memPkt = new Packet(true, false, PacketTypeLoad,
-				(op->mem_addr & ~3), 4, data, currCycle);
+		op->memPkt = ctx->packets->alloc(true, false, PacketTypeLoad,
+				(op->mem_addr & ~3), 4, ctx->currCycle);
 		break;
 	}
 	case OP_SB: {
-		uint8_t* data = new uint8_t;
-		*data = op->mem_value & 0xFF;
-		op->memPkt = new Packet(true, true, PacketTypeStore, (op->mem_addr), 1,
-				data, currCycle);
+		uint8_t data = op->mem_value & 0xFF;
+		op->memPkt = ctx->packets->alloc(true, true, PacketTypeStore,
+				(op->mem_addr), 1, ctx->currCycle);
+		memcpy(op->memPkt->data, &data, 1);
 		break;
 	}
 	case OP_SH: {
-		uint16_t* data = new uint16_t;
-		*data = op->mem_value & 0xFFFF;
-		op->memPkt = new Packet(true, true, PacketTypeStore, (op->mem_addr), 2,
-				(uint8_t*) data, currCycle);
+		uint16_t data = op->mem_value & 0xFFFF;
+		op->memPkt = ctx->packets->alloc(true, true, PacketTypeStore,
+				(op->mem_addr), 2, ctx->currCycle);
+		memcpy(op->memPkt->data, &data, 2);
 		break;
 	}
 
 	case OP_SW: {
-		uint32_t* data = new uint32_t;
-		*data = op->mem_value;
-		op->memPkt = new Packet(true, true, PacketTypeStore, (op->mem_addr), 4,
-				(uint8_t*) data, currCycle);
+		uint32_t data = op->mem_value;
+		op->memPkt = ctx->packets->alloc(true, true, PacketTypeStore,
+				(op->mem_addr), 4, ctx->currCycle);
+		memcpy(op->memPkt->data, &data, 4);
 		break;
 	}
 	}
 	DPRINTF(DEBUG_PIPE,
 			"sending pkt from memory stage: addr = %x, size = %d, type = %d \n",
 			op->memPkt->addr, op->memPkt->size, op->memPkt->type);
-	op->waitOnPktIssue = !(data_mem->sendReq(op->memPkt));
+	op->waitOnPktIssue = !(sendMem(data_mem, op->memPkt));
 	return;
 }
 
@@ -689,10 +787,14 @@ void PipeState::pipeStageFetch() {
 	if (decode_op != NULL)
 		return;
 
+	//while draining, only let the outstanding fetch complete
+	if (drainMode)
+		return;
+
 	if (fetch_op != NULL) {
 		if (fetch_op->isFetchIssued == false) {
 			//if sending the packet was unsuccessful before, try again
-			fetch_op->isFetchIssued = inst_mem->sendReq(fetch_op->instFetchPkt);
+			fetch_op->isFetchIssued = sendMem(inst_mem, fetch_op->instFetchPkt);
 			return;
 		}
 		if (fetch_op->readyForNextStage == false)
@@ -705,18 +807,16 @@ void PipeState::pipeStageFetch() {
 	}
 
 	assert(fetch_op == nullptr);
-	fetch_op = (Pipe_Op *) malloc(sizeof(Pipe_Op));
-	memset(fetch_op, 0, sizeof(Pipe_Op));
+	fetch_op = opPool.acquire();
 
 	fetch_op->reg_src1 = fetch_op->reg_src2 = fetch_op->reg_dst = -1;
 	fetch_op->pc = PC;
-	uint8_t* data = new uint8_t[4];
-	fetch_op->instFetchPkt = new Packet(true, false, PacketTypeFetch, PC, 4,
-			data, currCycle);
+	fetch_op->instFetchPkt = ctx->packets->alloc(true, false, PacketTypeFetch,
+			PC, 4, ctx->currCycle);
 	DPRINTF(DEBUG_PIPE, "sending pkt from fetch stage with addr %x \n: ",
 			fetch_op->instFetchPkt->addr);
 	//try to send the memory request
-	fetch_op->isFetchIssued = inst_mem->sendReq(fetch_op->instFetchPkt);
+	fetch_op->isFetchIssued = sendMem(inst_mem, fetch_op->instFetchPkt);
 	//get the next instruction to fetch from branch predictor
 	uint32_t target = BP->getTarget(PC);
 	if (target == -1) {
@@ -798,5 +898,5 @@ void PipeState::recvResp(Packet* pkt) {
 	default:
 		assert(false && "Invalid response from memory or cache");
 	}
-	delete pkt;
+	ctx->packets->free(pkt);
 }
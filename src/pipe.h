@@ -8,10 +8,15 @@
 #define __PIPE_H__
 
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <new>
 
 #include "abstract_branch_predictor.h"
 #include "abstract_memory.h"
 #include "base_object.h"
+#include "checkpoint.h"
 
 /* Pipeline ops (instances of this structure) are high-level representations of
  * the instructions that actually flow through the pipeline. This struct does
@@ -71,6 +76,56 @@ typedef struct Pipe_Op {
 	bool readyForNextStage;
 } Pipe_Op;
 
+//one op per pipeline stage can be alive, plus slack
+#define PIPE_OP_POOL_SIZE 8
+
+/*
+ * Fixed-capacity pool of Pipe_Ops with O(1) acquire and release. Each
+ * op sits in its own host cache line. Acquired ops are zeroed, like
+ * the malloc+memset they replace
+ */
+class PipeOpPool {
+public:
+	PipeOpPool() {
+		//new (C++11) doesn't honor the alignment of an over-aligned type
+		void* mem;
+		if (posix_memalign(&mem, alignof(Slot), sizeof(Slot) * PIPE_OP_POOL_SIZE))
+			throw std::bad_alloc();
+		slots = (Slot *) mem;
+		for (int i = 0; i < PIPE_OP_POOL_SIZE; i++)
+			freeOps[i] = &slots[i].op;
+		numFree = PIPE_OP_POOL_SIZE;
+	}
+
+	~PipeOpPool() {
+		free(slots);
+	}
+
+	PipeOpPool(const PipeOpPool&) = delete;
+	PipeOpPool& operator=(const PipeOpPool&) = delete;
+
+	Pipe_Op* acquire() {
+		assert(numFree > 0 && "Pipe_Op pool is exhausted");
+		Pipe_Op* op = freeOps[--numFree];
+		memset(op, 0, sizeof(Pipe_Op));
+		return op;
+	}
+
+	void release(Pipe_Op* op) {
+		assert(numFree < PIPE_OP_POOL_SIZE && "Pipe_Op released twice");
+		freeOps[numFree++] = op;
+	}
+
+private:
+	struct alignas(64) Slot {
+		Pipe_Op op;
+	};
+	Slot* slots;
+	//stack of the free ops
+	Pipe_Op* freeOps[PIPE_OP_POOL_SIZE];
+	int numFree;
+};
+
 /* The pipe state represents the current state of the pipeline. It holds a
  * pointer to the op that is currently at the input of each stage. As stages
  * execute, they remove the op from their input (set the pointer to NULL) and
@@ -80,13 +135,16 @@ typedef struct Pipe_Op {
  * be lost).
  */
 
-class PipeState: public BaseObject {
+class PipeState final : public BaseObject {
 public:
-	PipeState();
+	PipeState(SimContext* ctx, MemHrchyInfo* info);
 	~PipeState();
 	//pipe op currently at the input of the given stage (NULL for none)
 	Pipe_Op *fetch_op, *decode_op, *execute_op, *mem_op, *wb_op;
 
+	//storage of the pipe ops
+	PipeOpPool opPool;
+
 	//pointer to the branch predictor
 	AbstractBranchPredictor* BP;
 
@@ -107,6 +165,9 @@ public:
 	//if the simulator should keep running
 	int RUN_BIT;
 
+	//if set, the fetch stage does not pass new ops into the pipeline
+	bool drainMode;
+
 	//pointers to the first level of memory hierarchy
 	AbstractMemory* data_mem;
 	AbstractMemory* inst_mem;
@@ -125,6 +186,33 @@ public:
 	 * sets the fetch PC to the given destination. */
 	void pipeRecover(int flush, uint32_t dest);
 
+	/*
+	 * returns true if no pipeline stage can change any state in the
+	 * next cycle, i.e. the pipeline only waits for memory responses
+	 */
+	bool isStalledOnMemory();
+
+	/*
+	 * returns true if all the ops past fetch have retired and the
+	 * fetch stage has no request in flight (use with drainMode)
+	 */
+	bool isDrained();
+
+	/*
+	 * drop the op in the fetch stage (if any) and point PC back to
+	 * it, leaving an empty pipeline whose architectural state is
+	 * REGS, HI, LO and PC
+	 */
+	void squashFetch();
+
+	/*
+	 * save and restore the architectural state, the pipeline control
+	 * state, the statistics and the branch predictor. The pipeline
+	 * must be empty (see Simulator::drainPipeline)
+	 */
+	void serialize(CheckpointOut& cp);
+	void unserialize(CheckpointIn& cp);
+
 	//each of these functions implements one stage of the pipeline
 	void pipeStageFetch();
 	void pipeStageDecode();
@@ -139,6 +227,9 @@ public:
 
 	// place other information here as necessary
 
+private:
+	//send a request to data_mem or inst_mem
+	bool sendMem(AbstractMemory* mem, Packet* pkt);
 };
 
 #endif
@@ -6,11 +6,35 @@
 
 #include <cstdlib>
 #include <cstdio>
+#include <cassert>
 #include "repl_policy.h"
 #include "cache.h"
 
 AbstarctReplacementPolicy::AbstarctReplacementPolicy(Cache* cache) :
-		cache(cache) {
+		cache(cache), ctx(cache->ctx) {
+}
+
+int AbstarctReplacementPolicy::getFreeWay(uint32_t setIndex) {
+	uint32_t assoc = cache->getAssociativity();
+	uint64_t invalid = ~cache->getValidBits(setIndex);
+	if (assoc < 64)
+		invalid &= ((uint64_t) 1 << assoc) - 1;
+	return invalid ? __builtin_ctzll(invalid) : -1;
+}
+
+AbstarctReplacementPolicy* createReplacementPolicy(ReplacementPolicy type,
+		Cache* cache) {
+	switch (type) {
+	case RandomReplPolicy:
+		return new RandomRepl(cache);
+	case LRUReplPolicy:
+		return new LRURepl(cache);
+	case PLRUReplPolicy:
+		return new PLRURepl(cache);
+	default:
+		assert(false && "Unknown Replacement Policy");
+		return nullptr;
+	}
 }
 
 RandomRepl::RandomRepl(Cache* cache) :
@@ -18,19 +42,16 @@ RandomRepl::RandomRepl(Cache* cache) :
 }
 
 
-Block* RandomRepl::getVictim(uint32_t addr, bool isWrite) {
-	addr = addr / cache->getBlockSize();
-	uint64_t setIndex = (cache->getNumSets() - 1) & addr;
+int RandomRepl::getVictim(uint32_t addr, bool isWrite) {
+	uint32_t setIndex = cache->getSetIndex(addr);
 
 	//first check if there is a free block to allocate
-	for (int i = 0; i < (int) cache->getAssociativity(); i++) {
-		if (cache->blocks[setIndex][i]->getValid() == false) {
-			return cache->blocks[setIndex][i];
-		}
-	}
+	int freeWay = getFreeWay(setIndex);
+	if (freeWay != -1)
+		return freeWay;
 	//randomly choose a block
-	int victim_index = rand() % cache->getAssociativity();
-	return cache->blocks[setIndex][victim_index];
+	int victim_index = ctx->random.next() % cache->getAssociativity();
+	return victim_index;
 }
 
 void RandomRepl::update(uint32_t addr, int way, bool isWrite) {
@@ -46,63 +67,57 @@ void RandomRepl::update(uint32_t addr, int way, bool isWrite) {
 LRURepl::LRURepl(Cache *cache) :
 		AbstarctReplacementPolicy(cache) {
 
-	uint32_t numSets = cache->getNumSets();
-	lruCounter = new uint32_t*[numSets];
-
-	for (int i = 0; i < (int) numSets; i++) {
-		lruCounter[i] = new uint32_t[cache->getAssociativity()];
-		for (int j = 0; j < cache->getAssociativity(); j++)
-			lruCounter[i][j] = 0;
-	}
+	lruCounter.assign(cache->getNumSets() * cache->getAssociativity(), 0);
 
 }
 
 
-Block* LRURepl::getVictim(uint32_t addr, bool isWrite) {
-	addr = addr / cache->getBlockSize();
-	uint64_t setIndex = (cache->getNumSets() - 1) & addr;
+int LRURepl::getVictim(uint32_t addr, bool isWrite) {
+	uint32_t setIndex = cache->getSetIndex(addr);
 
 	//first check if there is a free block to allocate
-	for (int i = 0; i < (int) cache->getAssociativity(); i++) {
-		if (cache->blocks[setIndex][i]->getValid() == false) {
-			return cache->blocks[setIndex][i];
-		}
-	}
+	int freeWay = getFreeWay(setIndex);
+	if (freeWay != -1)
+		return freeWay;
 
+	uint32_t* counter = &lruCounter[setIndex * cache->getAssociativity()];
 	int minCounterIdx = 0;
 	for (int i = 0; i < cache->getAssociativity(); i++) {
-		if (lruCounter[setIndex][i] == 0) {
+		if (counter[i] == 0) {
 			minCounterIdx = i;
 			break;
 		}
 	}
-	return cache->blocks[setIndex][minCounterIdx];
+	return minCounterIdx;
 }
 
 void LRURepl::update(uint32_t addr, int way, bool isWrite) {
 	DPRINTF(DEBUG_MEMORY, "update LRU metadata :: START\n");
 
-	addr = addr / cache->getBlockSize();
-	uint64_t setIndex = (cache->getNumSets() - 1) & addr;
+	uint32_t setIndex = cache->getSetIndex(addr);
+	uint32_t* counter = &lruCounter[setIndex * cache->getAssociativity()];
 
 	for (int i = 0; i < cache->getAssociativity(); i++) {
-		if(lruCounter[setIndex][i] > lruCounter[setIndex][way])
-			lruCounter[setIndex][i] -= 1;
+		if(counter[i] > counter[way])
+			counter[i] -= 1;
 	}
 
-	lruCounter[setIndex][way] = cache->getAssociativity() - 1;
+	counter[way] = cache->getAssociativity() - 1;
 
 	DPRINTF(DEBUG_MEMORY, "update LRU metadata :: DONE\n");
 
 	return;
 }
 
+void LRURepl::serialize(CheckpointOut& cp) {
+	cp.write(lruCounter.data(), sizeof(uint32_t) * lruCounter.size());
+}
+
+void LRURepl::unserialize(CheckpointIn& cp) {
+	cp.read(lruCounter.data(), sizeof(uint32_t) * lruCounter.size());
+}
+
 LRURepl::~LRURepl() {
-	uint32_t numSets = cache->getNumSets();
-	for (int i = 0; i < (int) numSets; i++) {
-		delete lruCounter[i];
-	}
-	delete lruCounter;
 }
 
 /*
@@ -113,60 +128,51 @@ LRURepl::~LRURepl() {
 PLRURepl::PLRURepl(Cache* cache) :
 		AbstarctReplacementPolicy(cache) {
 
-	uint32_t numSets = cache->getNumSets();
-	plruFlags = new bool*[numSets];
-
-	for (int i = 0; i < (int) numSets; i++) {
-		plruFlags[i] = new bool[cache->getAssociativity()];
-		for (int j = 0; j < cache->getAssociativity(); j++)
-			plruFlags[i][j] = false;
-	}
+	plruFlags.assign(cache->getNumSets() * cache->getAssociativity(), false);
 }
 
 
-Block* PLRURepl::getVictim(uint32_t addr, bool isWrite) {
-	addr = addr / cache->getBlockSize();
-	uint64_t setIndex = (cache->getNumSets() - 1) & addr;
+int PLRURepl::getVictim(uint32_t addr, bool isWrite) {
+	uint32_t setIndex = cache->getSetIndex(addr);
 
 	//first check if there is a free block to allocate
-	for (int i = 0; i < (int) cache->getAssociativity(); i++) {
-		if (cache->blocks[setIndex][i]->getValid() == false) {
-			return cache->blocks[setIndex][i];
-		}
-	}
+	int freeWay = getFreeWay(setIndex);
+	if (freeWay != -1)
+		return freeWay;
 	// If all lines are valid, then
 	// choose first line in set which has false bit
+	uint8_t* flags = &plruFlags[setIndex * cache->getAssociativity()];
 	int victimIdx = 0;
 	for (int i = 0; i < cache->getAssociativity(); i++) {
-		if (!plruFlags[setIndex][i]) {
+		if (!flags[i]) {
 			victimIdx = i;
 			break;
 		}
 	}
-	return cache->blocks[setIndex][victimIdx];
+	return victimIdx;
 }
 
 void PLRURepl::update(uint32_t addr, int way, bool isWrite) {
 	DPRINTF(DEBUG_MEMORY, "update PLRU metadata :: START\n");
 
-	addr = addr / cache->getBlockSize();
-	uint64_t setIndex = (cache->getNumSets() - 1) & addr;
+	uint32_t setIndex = cache->getSetIndex(addr);
+	uint8_t* flags = &plruFlags[setIndex * cache->getAssociativity()];
 
-	plruFlags[setIndex][way] = true;
+	flags[way] = true;
 	bool isAllLinesOn = true;
 
 	for (int i = 0; i < cache->getAssociativity(); i++) {
-		if (!plruFlags[setIndex][i]) {
+		if (!flags[i]) {
 			isAllLinesOn = false;
 			break;
 		}
 	}
 	if(isAllLinesOn) {
 		for (int i = 0; i < cache->getAssociativity(); i++) {
-			plruFlags[setIndex][i] = false;
+			flags[i] = false;
 		}
 		// Finally keep this access most recently line ON
-		plruFlags[setIndex][way] = true;
+		flags[way] = true;
 	}
 
 	DPRINTF(DEBUG_MEMORY, "update PLRU metadata :: DONE\n");
@@ -174,10 +180,13 @@ void PLRURepl::update(uint32_t addr, int way, bool isWrite) {
 	return;
 }
 
+void PLRURepl::serialize(CheckpointOut& cp) {
+	cp.write(plruFlags.data(), plruFlags.size());
+}
+
+void PLRURepl::unserialize(CheckpointIn& cp) {
+	cp.read(plruFlags.data(), plruFlags.size());
+}
+
 PLRURepl::~PLRURepl() {
-	uint32_t numSets = cache->getNumSets();
-	for (int i = 0; i < (int) numSets; i++) {
-		delete plruFlags[i];
-	}
-	delete plruFlags;
 }
@@ -7,7 +7,9 @@
 #ifndef __REPL_POLICY_H__
 #define __REPL_POLICY_H__
 
-#include"block.h"
+#include <vector>
+#include "util.h"
+#include "checkpoint.h"
 
 class Cache;
 
@@ -21,53 +23,73 @@ public:
 	virtual ~AbstarctReplacementPolicy() {}
 	//pointer to the Cache
 	Cache* cache;
+	//the simulator instance of the cache
+	SimContext* ctx;
 	/*
-	 * should return the victim block based on the replacement
-	 * policy- the caller should invalidate this block
+	 * should return the way of the victim block in the set of addr
+	 * based on the replacement policy- the caller should invalidate
+	 * this block
 	 */
-	virtual Block* getVictim(uint32_t addr, bool isWrite) = 0;
+	virtual int getVictim(uint32_t addr, bool isWrite) = 0;
 	/*
 	 * Called for both hit and miss.
 	 * Should update the replacement policy metadata.
 	 */
 	virtual void update(uint32_t addr, int way, bool isWrite) = 0;
+
+	//lowest invalid way of a set, or -1 if all the ways are valid
+	int getFreeWay(uint32_t setIndex);
+
+	//save and restore the replacement metadata (none by default)
+	virtual void serialize(CheckpointOut& cp) {}
+	virtual void unserialize(CheckpointIn& cp) {}
 };
 
 /*
  * Random replacement policy
  */
-class RandomRepl: public AbstarctReplacementPolicy {
+class RandomRepl final : public AbstarctReplacementPolicy {
 public:
 	RandomRepl(Cache* cache);
 	~RandomRepl() {}
-	virtual Block* getVictim(uint32_t addr, bool isWrite) override;
+	virtual int getVictim(uint32_t addr, bool isWrite) override;
 	virtual void update(uint32_t addr, int way, bool isWrite) override;
 };
 
 /*
  * LRU replacement policy
  */
-class LRURepl: public AbstarctReplacementPolicy {
+class LRURepl final : public AbstarctReplacementPolicy {
 public:
 	LRURepl(Cache* cache);
 	virtual ~LRURepl();
 
-	uint32_t **lruCounter;
-	virtual Block* getVictim(uint32_t addr, bool isWrite) override;
+	//numSets x associativity counters, set-major
+	std::vector<uint32_t> lruCounter;
+	virtual int getVictim(uint32_t addr, bool isWrite) override;
 	virtual void update(uint32_t addr, int way, bool isWrite) override;
+	virtual void serialize(CheckpointOut& cp) override;
+	virtual void unserialize(CheckpointIn& cp) override;
 };
 
 /*
  * Pseudo LRU replacement policy
  */
-class PLRURepl: public AbstarctReplacementPolicy {
+class PLRURepl final : public AbstarctReplacementPolicy {
 public:
 	PLRURepl(Cache* cache);
 	virtual ~PLRURepl();
 
-	bool **plruFlags;
-	virtual Block* getVictim(uint32_t addr, bool isWrite) override;
+	//numSets x associativity flags, set-major
+	std::vector<uint8_t> plruFlags;
+	virtual int getVictim(uint32_t addr, bool isWrite) override;
 	virtual void update(uint32_t addr, int way, bool isWrite) override;
+	virtual void serialize(CheckpointOut& cp) override;
+	virtual void unserialize(CheckpointIn& cp) override;
 };
 
+//create the replacement policy of the given type for a cache
+AbstarctReplacementPolicy* createReplacementPolicy(ReplacementPolicy type,
+		Cache* cache);
+
 #endif
@@ -0,0 +1,174 @@
+/*
+ * Computer Architecture CSE530
+ * MIPS pipeline cycle-accurate simulator
+ * PSU
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <unistd.h>
+#include "result_cache.h"
+
+#define RESULT_CACHE_MAGIC "MIPSRESULT 3"
+
+//64-bit FNV-1a
+static uint64_t hashBytes(uint64_t hash, const void* data, uint64_t size) {
+	const uint8_t* bytes = (const uint8_t*) data;
+	for (uint64_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+//hash of the running simulator binary, computed once
+static uint64_t hashSimulator() {
+	static uint64_t simHash = 0;
+	if (simHash != 0)
+		return simHash;
+
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	FILE* exe = fopen("/proc/self/exe", "rb");
+	if (exe) {
+		uint8_t buffer[65536];
+		uint64_t n;
+		while ((n = fread(buffer, 1, sizeof(buffer), exe)) > 0)
+			hash = hashBytes(hash, buffer, n);
+		fclose(exe);
+	}
+	simHash = hash;
+	return simHash;
+}
+
+ResultCache::ResultCache(const char* dir) :
+		dir(dir), hash(0) {
+
+}
+
+ResultCache::~ResultCache() {
+
+}
+
+void ResultCache::setKey(MemHrchyInfo* info,
+		const std::vector<std::string>& programs,
+		const std::string& script) {
+	std::ostringstream str;
+	str << "cache_size_l1=" << info->cache_size_l1 << "\n"
+			<< "cache_assoc_l1=" << info->cache_assoc_l1 << "\n"
+			<< "cache_size_l2=" << info->cache_size_l2 << "\n"
+			<< "cache_assoc_l2=" << info->cache_assoc_l2 << "\n"
+			<< "cache_blk_size=" << info->cache_blk_size << "\n"
+			<< "repl_policy_l1i=" << info->repl_policy_l1i << "\n"
+			<< "repl_policy_l1d=" << info->repl_policy_l1d << "\n"
+			<< "repl_policy_l2=" << info->repl_policy_l2 << "\n"
+			<< "access_delay_l1=" << info->access_delay_l1 << "\n"
+			<< "access_delay_l2=" << info->access_delay_l2 << "\n"
+			<< "memDelay=" << info->memDelay << "\n"
+			<< "req_queue_size_l1=" << info->req_queue_size_l1 << "\n"
+			<< "req_queue_size_l2=" << info->req_queue_size_l2 << "\n"
+			<< "req_queue_size_mem=" << info->req_queue_size_mem << "\n"
+			<< "bht_entries=" << info->bht_entries << "\n"
+			<< "bht_entry_width=" << info->bht_entry_width << "\n"
+			<< "pht_width=" << info->pht_width << "\n"
+			<< "btb_size=" << info->btb_size << "\n"
+			<< "skipIdleCycles=" << info->skipIdleCycles << "\n"
+			<< "cacheTagOnly=" << info->cacheTagOnly << "\n"
+			<< "debugMemory=" << info->debugMemory << "\n"
+			<< "debugPipe=" << info->debugPipe << "\n"
+			<< "debugCache=" << info->debugCache << "\n"
+			<< "debugPrefetch=" << info->debugPrefetch << "\n"
+			<< "traceMemory=" << info->traceMemory << "\n";
+	config = str.str();
+	this->programs.clear();
+	for (uint32_t i = 0; i < programs.size(); i++) {
+		uint64_t size = programs[i].size();
+		this->programs.append((const char*) &size, sizeof(size));
+		this->programs.append(programs[i]);
+	}
+	this->script = script;
+
+	hash = hashSimulator();
+	hash = hashBytes(hash, config.data(), config.size());
+	hash = hashBytes(hash, this->programs.data(), this->programs.size());
+	hash = hashBytes(hash, script.data(), script.size());
+}
+
+std::string ResultCache::entryPath() {
+	char name[17];
+	snprintf(name, sizeof(name), "%016lx", hash);
+	return dir + "/" + name;
+}
+
+bool ResultCache::lookup(std::string& output) {
+	FILE* entry = fopen(entryPath().c_str(), "rb");
+	if (entry == NULL)
+		return false;
+
+	//header: magic, then the sizes of the config, programs, script and output
+	char magic[sizeof(RESULT_CACHE_MAGIC)];
+	uint64_t sizes[4];
+	bool ok = fread(magic, 1, sizeof(magic), entry) == sizeof(magic)
+			&& memcmp(magic, RESULT_CACHE_MAGIC, sizeof(magic)) == 0
+			&& fread(sizes, sizeof(uint64_t), 4, entry) == 4
+			&& sizes[0] == config.size() && sizes[1] == programs.size()
+			&& sizes[2] == script.size();
+
+	std::string savedConfig(ok ? sizes[0] : 0, '\0');
+	std::string savedPrograms(ok ? sizes[1] : 0, '\0');
+	std::string savedScript(ok ? sizes[2] : 0, '\0');
+	if (ok) {
+		output.assign(sizes[3], '\0');
+		ok = fread(&savedConfig[0], 1, sizes[0], entry) == sizes[0]
+				&& fread(&savedPrograms[0], 1, sizes[1], entry) == sizes[1]
+				&& fread(&savedScript[0], 1, sizes[2], entry) == sizes[2]
+				&& fread(&output[0], 1, sizes[3], entry) == sizes[3]
+				&& savedConfig == config && savedPrograms == programs
+				&& savedScript == script;
+	}
+	fclose(entry);
+	return ok;
+}
+
+bool ResultCache::store(const std::string& output) {
+	//write a private file and rename it, so readers never see a partial entry
+	std::string path = entryPath();
+	std::string tmpPath = path + "." + std::to_string(getpid());
+	FILE* entry = fopen(tmpPath.c_str(), "wb");
+	if (entry == NULL)
+		return false;
+
+	uint64_t sizes[4] = { config.size(), programs.size(), script.size(),
+			output.size() };
+	fwrite(RESULT_CACHE_MAGIC, 1, sizeof(RESULT_CACHE_MAGIC), entry);
+	fwrite(sizes, sizeof(uint64_t), 4, entry);
+	fwrite(config.data(), 1, config.size(), entry);
+	fwrite(programs.data(), 1, programs.size(), entry);
+	fwrite(script.data(), 1, script.size(), entry);
+	fwrite(output.data(), 1, output.size(), entry);
+	bool ok = !ferror(entry);
+	ok = fclose(entry) == 0 && ok;
+
+	if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+		unlink(tmpPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool ResultCache::isCacheable(const std::string& script) {
+	std::istringstream commands(script);
+	std::string word;
+	//any word that may be a ckpt, image or mbin command (getCommand only checks the first letters)
+	while (commands >> word) {
+		if (word[0] == 'c' || word[0] == 'C')
+			return false;
+		if ((word[0] == 'i' || word[0] == 'I')
+				&& (word[1] == 'm' || word[1] == 'M'))
+			return false;
+		if ((word[0] == 'm' || word[0] == 'M')
+				&& (word[1] == 'b' || word[1] == 'B'))
+			return false;
+	}
+	return true;
+}
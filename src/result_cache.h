@@ -0,0 +1,58 @@
+/*
+ * Computer Architecture CSE530
+ * MIPS pipeline cycle-accurate simulator
+ * PSU
+ */
+
+#ifndef __RESULT_CACHE_H__
+#define __RESULT_CACHE_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "util.h"
+
+/*
+ * Content-addressed store of simulation outputs. A simulation is
+ * identified by the parsed config values, the bytes of the program
+ * files (hex, ELF or memory image), the command script and the simulator binary itself, so a rebuilt
+ * simulator never returns stale results. Each entry is a file in the
+ * store directory named after the 64-bit hash of that key. The entry
+ * also holds the config, the program files and the script verbatim,
+ * which are compared on lookup to guard against hash collisions
+ */
+class ResultCache {
+public:
+	ResultCache(const char* dir);
+	virtual ~ResultCache();
+
+	//set the key of the simulation to look up or store
+	void setKey(MemHrchyInfo* info,
+			const std::vector<std::string>& programs,
+			const std::string& script);
+
+	//returns true and the recorded output if the simulation is stored
+	bool lookup(std::string& output);
+
+	//record the output of the simulation, returns false on failure
+	bool store(const std::string& output);
+
+	/*
+	 * scripts whose result depends on other files (checkpoints) or
+	 * that write memory images or dumps can't be cached
+	 */
+	static bool isCacheable(const std::string& script);
+
+private:
+	std::string dir;
+	//canonical text of the config values
+	std::string config;
+	//size and bytes of each program file
+	std::string programs;
+	std::string script;
+	uint64_t hash;
+
+	std::string entryPath();
+};
+
+#endif
@@ -5,23 +5,34 @@
  */
 
 #include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
 #include "simulator.h"
+#include "functional_core.h"
 #include "util.h"
 
-uint64_t currCycle;
-
-Simulator::Simulator(MemHrchyInfo* info) {
-	currCycle = 0;
-	printf("initialize simulator\n\n");
+Simulator::Simulator(MemHrchyInfo* info, FILE* out) :
+		ctx(out) {
+	ctx.packets = &packetPool;
+	ctx.DEBUG_MEMORY = info->debugMemory;
+	ctx.DEBUG_PIPE = info->debugPipe;
+	ctx.DEBUG_CACHE = info->debugCache;
+	ctx.DEBUG_PREFETCH = info->debugPrefetch;
+	ctx.TRACE_MEMORY = info->traceMemory;
+	skipIdleCycles = info->skipIdleCycles;
+	failed = false;
+	fprintf(ctx.out, "initialize simulator\n\n");
 	//initializing core
-	pipe = new PipeState();
+	pipe = new PipeState(&ctx, info);
 
 	// CSE530: add caches
-	main_memory = new BaseMemory(info->memDelay);
-	l1DCache = new Cache(info->cache_size_l1, info->cache_assoc_l1, info->cache_blk_size, info->repl_policy_l1d, info->access_delay_l1, L1D);
-	l1ICache = new Cache(info->cache_size_l1, info->cache_assoc_l1, info->cache_blk_size, info->repl_policy_l1i, info->access_delay_l1, L1I);
-	l2Cache = new Cache(info->cache_size_l2, info->cache_assoc_l2, info->cache_blk_size, info->repl_policy_l2, info->access_delay_l2, L2);
+	main_memory = new BaseMemory(&ctx, info->memDelay, info->req_queue_size_mem);
+	l1DCache = new Cache(&ctx, info->cache_size_l1, info->cache_assoc_l1, info->cache_blk_size, info->repl_policy_l1d, info->access_delay_l1, info->req_queue_size_l1, L1D, info->cacheTagOnly);
+	l1ICache = new Cache(&ctx, info->cache_size_l1, info->cache_assoc_l1, info->cache_blk_size, info->repl_policy_l1i, info->access_delay_l1, info->req_queue_size_l1, L1I, info->cacheTagOnly);
+	l2Cache = new Cache(&ctx, info->cache_size_l2, info->cache_assoc_l2, info->cache_blk_size, info->repl_policy_l2, info->access_delay_l2, info->req_queue_size_l2, L2, info->cacheTagOnly);
 
 	//set the responder for memory operations
 	l1ICache->next = l2Cache;
@@ -36,27 +47,49 @@ Simulator::Simulator(MemHrchyInfo* info) {
 	main_memory->next = nullptr;
 	main_memory->prev = l2Cache;
 
+	//memory objects are serviced in this order within a cycle
+	eventQueue = new EventQueue();
+	eventQueue->addObject(main_memory);
+	eventQueue->addObject(l2Cache);
+	eventQueue->addObject(l1DCache);
+	eventQueue->addObject(l1ICache);
+
 	//set the first memory in the memory-hierarchy
 	pipe->data_mem = l1DCache;
 	pipe->inst_mem = l1ICache;
+
+	//this is the standard topology, let the objects call each other directly
+	ctx.staticHierarchy = true;
 }
 
 
 
 void Simulator::cycle() {
-	//check if memory needs to respond to any packet in this cycle
-	main_memory->Tick();
-
-	// CSE530: check if caches need to respond to any packet in this cycle
-	l2Cache->Tick();
-	l1DCache->Tick();
-	l1ICache->Tick();
+	//memory and caches respond to the packets that are ready in this cycle
+	eventQueue->serviceEvents(ctx.currCycle);
 
 	//progress of the pipeline in this clock
 	pipe->pipeCycle();
 	pipe->stat_cycles++;
 	// increment the global clock of the simulator
-	currCycle++;
+	ctx.currCycle++;
+}
+
+uint64_t Simulator::skipIdle(uint64_t max_cycles) {
+	//per-cycle pipeline debug output must not lose any cycle
+	if (!skipIdleCycles || ctx.DEBUG_PIPE || !pipe->isStalledOnMemory())
+		return 0;
+
+	uint64_t next = eventQueue->nextEventTime();
+
+	//nothing is pending (a deadlock), let the normal cycle loop handle it
+	if (next == UINT64_MAX || next <= ctx.currCycle)
+		return 0;
+
+	uint64_t skipped = std::min(next - ctx.currCycle, max_cycles);
+	pipe->stat_cycles += skipped;
+	ctx.currCycle += skipped;
+	return skipped;
 }
 
 
@@ -64,16 +97,19 @@ void Simulator::cycle() {
 void Simulator::run(int num_cycles) {
 	int i;
 	if (pipe->RUN_BIT == false) {
-		printf("Can't simulate, Simulator is halted\n\n");
+		fprintf(ctx.out, "Can't simulate, Simulator is halted\n\n");
 		return;
 	}
 
-	printf("Simulating for %d cycles...\n\n", num_cycles);
+	fprintf(ctx.out, "Simulating for %d cycles...\n\n", num_cycles);
 	for (i = 0; i < num_cycles; i++) {
 		if (pipe->RUN_BIT == false) {
-			printf("Simulator halted\n\n");
+			fprintf(ctx.out, "Simulator halted\n\n");
 			break;
 		}
+		i += skipIdle(num_cycles - i);
+		if (i == num_cycles)
+			break;
 		cycle();
 	}
 }
@@ -81,56 +117,301 @@ void Simulator::run(int num_cycles) {
 
 void Simulator::go() {
 	if (pipe->RUN_BIT == false) {
-		printf("Can't simulate, Simulator is halted\n\n");
+		fprintf(ctx.out, "Can't simulate, Simulator is halted\n\n");
 		return;
 	}
 
-	printf("Simulating...\n\n");
-	while (pipe->RUN_BIT)
+	fprintf(ctx.out, "Simulating...\n\n");
+	while (pipe->RUN_BIT) {
+		skipIdle(UINT64_MAX);
+		cycle();
+	}
+	fprintf(ctx.out, "Simulator halted\n\n");
+}
+
+
+
+void Simulator::drainPipeline(bool drainMemory) {
+	pipe->drainMode = true;
+	while (pipe->RUN_BIT
+			&& (!pipe->isDrained() || (drainMemory && eventQueue->numPending))) {
+		skipIdle(UINT64_MAX);
 		cycle();
-	printf("Simulator halted\n\n");
+	}
+	pipe->drainMode = false;
+	//after a HALT, PC already is the final one
+	if (pipe->RUN_BIT)
+		pipe->squashFetch();
 }
 
+uint64_t Simulator::runInsts(uint64_t num_insts) {
+	uint64_t start = pipe->stat_inst_retire;
+	while (pipe->RUN_BIT && pipe->stat_inst_retire - start < num_insts) {
+		skipIdle(UINT64_MAX);
+		cycle();
+	}
+	return pipe->stat_inst_retire - start;
+}
+
+void Simulator::fastForward(uint64_t num_insts) {
+	if (pipe->RUN_BIT == false) {
+		fprintf(ctx.out, "Can't simulate, Simulator is halted\n\n");
+		return;
+	}
 
+	//retire the ops that are already in the pipeline
+	drainPipeline();
+	if (pipe->RUN_BIT == false) {
+		fprintf(ctx.out, "Simulator halted\n\n");
+		return;
+	}
 
-uint32_t Simulator::readMemForDump(uint32_t address) {
-	uint32_t data;
-	//you should update this since adding the caches
-	pipe->data_mem->dumpRead(address, 4, (uint8_t*) &data);
-	return data;
+	fprintf(ctx.out, "Fast-forwarding %lu instructions...\n\n", num_insts);
+	FunctionalCore core(pipe, main_memory);
+	uint64_t executed = core.run(num_insts);
+	fprintf(ctx.out, "Fast-forwarded %lu instructions\n\n", executed);
+	if (pipe->RUN_BIT == false)
+		fprintf(ctx.out, "Simulator halted\n\n");
+}
+
+void Simulator::sample(uint64_t interval, uint64_t unit, uint64_t warmup) {
+	if (pipe->RUN_BIT == false) {
+		fprintf(ctx.out, "Can't simulate, Simulator is halted\n\n");
+		return;
+	}
+	if (unit == 0 || interval < unit + warmup) {
+		fprintf(ctx.out, "Invalid sampling parameters\n\n");
+		return;
+	}
+
+	fprintf(ctx.out, "Sampling %lu of every %lu instructions (%lu warm-up)...\n\n",
+			unit, interval, warmup);
+	FunctionalCore core(pipe, main_memory);
+	core.warming = true;
+
+	uint64_t numSamples = 0, totalInsts = 0;
+	double sumCPI = 0, sumSqCPI = 0;
+	while (pipe->RUN_BIT) {
+		//functional warming for the rest of the interval
+		totalInsts += core.run(interval - unit - warmup);
+
+		//detailed warming of the pipeline
+		totalInsts += runInsts(warmup);
+
+		//measured unit
+		uint64_t startCycles = pipe->stat_cycles;
+		uint64_t insts = runInsts(unit);
+		uint64_t cycles = pipe->stat_cycles - startCycles;
+		totalInsts += insts;
+		//a unit cut short by the HALT is not representative
+		if (insts == unit) {
+			double cpi = (double) cycles / insts;
+			sumCPI += cpi;
+			sumSqCPI += cpi * cpi;
+			numSamples++;
+		}
+		//draining a halted pipeline would only disturb the final state
+		if (pipe->RUN_BIT == false)
+			break;
+
+		uint64_t retired = pipe->stat_inst_retire;
+		drainPipeline();
+		totalInsts += pipe->stat_inst_retire - retired;
+	}
+	fprintf(ctx.out, "Simulator halted\n\n");
+
+	fprintf(ctx.out, "Instructions: %lu\n", totalInsts);
+	fprintf(ctx.out, "Samples: %lu\n", numSamples);
+	if (numSamples == 0)
+		return;
+	double meanCPI = sumCPI / numSamples;
+	//95% confidence interval of the mean (normal approximation)
+	double ci = 0;
+	if (numSamples > 1) {
+		double var = (sumSqCPI - numSamples * meanCPI * meanCPI)
+				/ (numSamples - 1);
+		ci = 1.96 * sqrt(var > 0 ? var : 0) / sqrt(numSamples);
+	}
+	fprintf(ctx.out, "EstimatedCPI: %0.3f +- %0.3f (%0.1f%%)\n", meanCPI, ci,
+			100 * ci / meanCPI);
+	fprintf(ctx.out, "EstimatedIPC: %0.3f [%0.3f, %0.3f]\n", 1 / meanCPI,
+			1 / (meanCPI + ci), meanCPI > ci ? 1 / (meanCPI - ci) : INFINITY);
+	fprintf(ctx.out, "EstimatedCycles: %0.0f\n\n", meanCPI * totalInsts);
+}
+
+void Simulator::setAccessDelays(uint32_t l1Delay, uint32_t l2Delay,
+		uint32_t memDelay) {
+	l1ICache->accessDelay = l1Delay;
+	l1DCache->accessDelay = l1Delay;
+	l2Cache->accessDelay = l2Delay;
+	main_memory->accessDelay = memDelay;
+}
+
+void Simulator::saveCheckpoint(const char* filename) {
+	if (pipe->RUN_BIT == false) {
+		fprintf(ctx.out, "Can't checkpoint, Simulator is halted\n\n");
+		return;
+	}
+
+	//no op or packet is in flight after this, only the state is saved
+	drainPipeline(true);
+	assert(packetPool.numLive == 0 && "a packet leaked");
+
+	CheckpointOut cp(filename);
+	if (!cp.isOpen()) {
+		fprintf(ctx.out, "Error: Can't create checkpoint file %s\n\n", filename);
+		failed = true;
+		return;
+	}
+	cp.write(ctx.currCycle);
+	cp.write(ctx.random);
+	pipe->serialize(cp);
+	l1ICache->serialize(cp);
+	l1DCache->serialize(cp);
+	l2Cache->serialize(cp);
+	main_memory->serialize(cp);
+	if (!cp.close()) {
+		fprintf(ctx.out, "Error: Can't write checkpoint file %s\n\n", filename);
+		failed = true;
+		return;
+	}
+	fprintf(ctx.out, "Checkpoint saved to %s at cycle %lu\n\n", filename, ctx.currCycle);
+}
+
+void Simulator::loadCheckpoint(const char* filename) {
+	if (pipe->RUN_BIT == false) {
+		fprintf(ctx.out, "Can't checkpoint, Simulator is halted\n\n");
+		return;
+	}
+
+	//the ops and packets in flight belong to the state being replaced
+	drainPipeline(true);
+
+	CheckpointIn cp(filename);
+	if (cp.failed()) {
+		//nothing was restored, the simulator can go on
+		fprintf(ctx.out, "Error: checkpoint %s: %s\n\n", filename,
+				cp.getError().c_str());
+		failed = true;
+		return;
+	}
+	cp.read(ctx.currCycle);
+	cp.read(ctx.random);
+	pipe->unserialize(cp);
+	l1ICache->unserialize(cp);
+	l1DCache->unserialize(cp);
+	l2Cache->unserialize(cp);
+	main_memory->unserialize(cp);
+	if (cp.failed()) {
+		//a partly restored state must not be simulated
+		fprintf(ctx.out, "Error: checkpoint %s: %s\n\n", filename,
+				cp.getError().c_str());
+		pipe->RUN_BIT = false;
+		failed = true;
+		return;
+	}
+	fprintf(ctx.out, "Checkpoint loaded from %s at cycle %lu\n\n", filename, ctx.currCycle);
+}
+
+void Simulator::saveMemImage(const char* filename) {
+	//draining the stores in flight would change the timing of the rest of the run
+	if (pipe->RUN_BIT) {
+		fprintf(ctx.out, "Can't write a memory image, Simulator is running\n\n");
+		failed = true;
+		return;
+	}
+	//after HALT no store is in flight
+	if (!main_memory->saveImage(filename)) {
+		fprintf(ctx.out, "Error: Can't write memory image %s\n\n", filename);
+		failed = true;
+		return;
+	}
+	fprintf(ctx.out, "Memory image saved to %s (%lu pages)\n\n", filename,
+			main_memory->numPages);
 }
 
 void Simulator::registerDump() {
 	int i;
 
-	printf("PC: 0x%08x\n", pipe->PC);
+	fprintf(ctx.out, "PC: 0x%08x\n", pipe->PC);
 
 	for (i = 0; i < 32; i++) {
-		printf("R%d: 0x%08x\n", i, pipe->REGS[i]);
+		fprintf(ctx.out, "R%d: 0x%08x\n", i, pipe->REGS[i]);
 	}
 
-	printf("HI: 0x%08x\n", pipe->HI);
-	printf("LO: 0x%08x\n", pipe->LO);
-	printf("Cycles: %u\n", pipe->stat_cycles);
-	printf("FetchedInstr: %u\n", pipe->stat_inst_fetch);
-	printf("RetiredInstr: %u\n", pipe->stat_inst_retire);
-	printf("IPC: %0.3f\n",
+	fprintf(ctx.out, "HI: 0x%08x\n", pipe->HI);
+	fprintf(ctx.out, "LO: 0x%08x\n", pipe->LO);
+	fprintf(ctx.out, "Cycles: %u\n", pipe->stat_cycles);
+	fprintf(ctx.out, "FetchedInstr: %u\n", pipe->stat_inst_fetch);
+	fprintf(ctx.out, "RetiredInstr: %u\n", pipe->stat_inst_retire);
+	fprintf(ctx.out, "IPC: %0.3f\n",
 			((float) pipe->stat_inst_retire) / pipe->stat_cycles);
-	printf("Flushes: %u\n", pipe->stat_squash);
+	fprintf(ctx.out, "Flushes: %u\n", pipe->stat_squash);
+}
+
+void Simulator::readMemRange(uint32_t start, uint32_t len,
+		std::vector<uint8_t>& data) {
+	data.resize(len);
+	if (len > 0)
+		pipe->data_mem->dumpReadRange(start, len, &data[0]);
 }
 
 void Simulator::memDump(int start, int stop) {
-	int address;
+	std::vector<uint8_t> data;
+	//whole words from start up to stop
+	uint32_t len = stop > start ? ((int64_t) stop - start + 3) & ~3 : 0;
+	readMemRange(start, len, data);
 
-	printf("\nMemory content [0x%08x..0x%08x] :\n", start, stop);
-	printf("-------------------------------------\n");
-	for (address = start; address < stop; address += 4) {
-		printf("MEM[0x%08x]: 0x%08x\n", address, readMemForDump(address));
+	fprintf(ctx.out, "\nMemory content [0x%08x..0x%08x] :\n", start, stop);
+	fprintf(ctx.out, "-------------------------------------\n");
+	for (uint32_t i = 0; i < len; i += 4) {
+		uint32_t word;
+		memcpy(&word, &data[i], 4);
+		fprintf(ctx.out, "MEM[0x%08x]: 0x%08x\n", start + i, word);
+	}
+	fprintf(ctx.out, "\n");
+}
+
+void Simulator::memDumpHex(uint32_t start, uint32_t stop) {
+	std::vector<uint8_t> data;
+	readMemRange(start, stop > start ? stop - start : 0, data);
+
+	fprintf(ctx.out, "\nMemory content [0x%08x..0x%08x] :\n", start, stop);
+	fprintf(ctx.out, "-------------------------------------\n");
+	for (uint32_t i = 0; i < data.size(); i += 16) {
+		fprintf(ctx.out, "0x%08x:", start + i);
+		for (uint32_t j = i; j < i + 16 && j < data.size(); j++)
+			fprintf(ctx.out, "%s%02x", (j & 3) ? "" : " ", data[j]);
+		fprintf(ctx.out, "\n");
+	}
+	fprintf(ctx.out, "\n");
+}
+
+void Simulator::memDumpBinary(uint32_t start, uint32_t stop,
+		const char* filename) {
+	std::vector<uint8_t> data;
+	readMemRange(start, stop > start ? stop - start : 0, data);
+
+	FILE* file = fopen(filename, "wb");
+	bool ok = file != NULL;
+	if (ok) {
+		ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+		ok = fclose(file) == 0 && ok;
+	}
+	if (!ok) {
+		fprintf(ctx.out, "Error: Can't write memory dump %s\n\n", filename);
+		failed = true;
+		return;
 	}
-	printf("\n");
+	fprintf(ctx.out, "Memory [0x%08x..0x%08x] written to %s\n\n", start, stop,
+			filename);
 }
 
 Simulator::~Simulator() {
+	delete l1ICache;
+	delete l1DCache;
+	delete l2Cache;
 	delete main_memory;
 	delete pipe;
+	delete eventQueue;
 }
@@ -7,17 +7,27 @@
 #ifndef __SIMULATOR_H__
 #define __SIMULATOR_H__
 
+#include <vector>
 #include "base_memory.h"
 #include "pipe.h"
 #include "util.h"
 
 // CSE530
 #include "cache.h"
+#include "event_queue.h"
+#include "packet_pool.h"
 
 class Simulator {
 public:
-	Simulator(MemHrchyInfo* info);
+	Simulator(MemHrchyInfo* info, FILE* out = stdout);
 	virtual ~Simulator();
+
+	//clock, debug flags and output of this simulator instance
+	SimContext ctx;
+
+	//memory packets of this simulator instance
+	PacketPool packetPool;
+
 	PipeState * pipe;
 	BaseMemory * main_memory;
 
@@ -26,11 +36,27 @@ public:
 	Cache * l1DCache;
 	Cache * l2Cache;
 
+	//completion events of all the memory objects
+	EventQueue * eventQueue;
+
+	//jump over cycles in which the pipeline only waits for memory
+	bool skipIdleCycles;
+
+	//a checkpoint, image or dump command failed, the batch runs report it
+	bool failed;
+
 	/*
 	 * Execute a cycle
 	 */
 	void cycle();
 
+	/*
+	 * If the pipeline is stalled on memory, advance the clock (at most
+	 * max_cycles) to the earliest cycle in which an event is scheduled.
+	 * Returns the number of skipped cycles
+	 */
+	uint64_t skipIdle(uint64_t max_cycles);
+
 	/*
 	 * Simulation for n cycles
 	 */
@@ -41,23 +67,94 @@ public:
 	 */
 	void go();
 
-	// Debug functions
+	/*
+	 * Drain the pipeline and execute n instructions functionally
+	 * (no pipeline or cache timing), then continue in detail
+	 */
+	void fastForward(uint64_t num_insts);
+
+	/*
+	 * SMARTS-style sampled simulation until HALTed. Every interval
+	 * instructions, warmup instructions are simulated in detail to
+	 * warm the pipeline and the next unit instructions are measured;
+	 * the rest run functionally while warming the caches and the
+	 * branch predictor. Prints the estimated CPI and IPC with their
+	 * 95% confidence interval
+	 */
+	void sample(uint64_t interval, uint64_t unit, uint64_t warmup);
+
+	/*
+	 * Simulation in detail until num_insts more instructions retire
+	 * or HALTed. Returns the number of retired instructions
+	 */
+	uint64_t runInsts(uint64_t num_insts);
+
+	/*
+	 * Retire all the ops in the pipeline and squash the one in fetch,
+	 * so that the architectural state can be handed to FunctionalCore.
+	 * With drainMemory, also wait until no memory event is pending.
+	 * If the program halts meanwhile, nothing is squashed
+	 */
+	void drainPipeline(bool drainMemory = false);
 
 	/*
-	 * Read a 32-bit word from memory for memDump
+	 * Change the access delays of the caches and the main memory.
+	 * Only use it with nothing in flight (see drainPipeline)
 	 */
-	uint32_t readMemForDump(uint32_t address);
+	void setAccessDelays(uint32_t l1Delay, uint32_t l2Delay, uint32_t memDelay);
+
+	/*
+	 * Drain the pipeline and the memory hierarchy and save the state
+	 * of the whole simulator (core, branch predictor, caches and main
+	 * memory) to a binary checkpoint file
+	 */
+	void saveCheckpoint(const char* filename);
+
+	/*
+	 * Restore a checkpoint saved with the same configuration. The
+	 * main memory is mapped from the file rather than read. If the
+	 * checkpoint is bad, prints the error and sets failed. A file that
+	 * can't be opened or isn't a checkpoint leaves the state untouched,
+	 * an error after that halts the simulator (the state may be partly
+	 * restored)
+	 */
+	void loadCheckpoint(const char* filename);
+
+	/*
+	 * Write the final memory state to a memory image (see BaseMemory).
+	 * Only once the program has halted: the caches are write-through
+	 * and no store is in flight then, so the main memory holds the
+	 * coherent state
+	 */
+	void saveMemImage(const char* filename);
+
+	// Debug functions
 
 	/*
 	 * Print architectural registers and other stats
 	 */
 	void registerDump();
 
+	/*
+	 * Read [start, start+len) of memory as the program sees it
+	 */
+	void readMemRange(uint32_t start, uint32_t len, std::vector<uint8_t>& data);
+
 	/*
 	 * Print a word-aligned region of memory to the output file
 	 */
 	void memDump(int start, int stop);
 
+	/*
+	 * Print [start, stop) of memory as hex bytes, 16 per line
+	 */
+	void memDumpHex(uint32_t start, uint32_t stop);
+
+	/*
+	 * Write the raw bytes of [start, stop) of memory to a file
+	 */
+	void memDumpBinary(uint32_t start, uint32_t stop, const char* filename);
+
 
 };
 
@@ -0,0 +1,335 @@
+/*
+ * Computer Architecture CSE530
+ * MIPS pipeline cycle-accurate simulator
+ * PSU
+ */
+
+#include <cstdio>
+#include <map>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <fstream>
+#include <sstream>
+#include "sweep.h"
+#include "batch_runner.h"
+#include "commands.h"
+#include "config_reader.h"
+
+Sweep::Sweep() :
+		commands("go") {
+
+}
+
+Sweep::~Sweep() {
+
+}
+
+bool Sweep::readSweepFile(const char* filename) {
+	std::ifstream file(filename);
+	if (!file) {
+		printf("Error: Can't open sweep file %s\n", filename);
+		return false;
+	}
+	std::stringstream str;
+	str << file.rdbuf();
+	std::string json = str.str();
+	ConfigReader msg;
+	msg.setJson(json);
+
+	if (msg.getValue("config") == Json::nullValue) {
+		printf("Error: %s: config is not defined\n", filename);
+		return false;
+	}
+	MemHrchyInfo* info = getMemHrchyInfo(msg.getValue("config").asCString());
+	baseInfo = *info;
+	delete info;
+
+	if (msg.getValue("warmup") != Json::nullValue)
+		warmup = msg.getValue("warmup").asString();
+	if (msg.getValue("commands") != Json::nullValue)
+		commands = msg.getValue("commands").asString();
+	if (msg.getValue("output") != Json::nullValue)
+		outputFile = msg.getValue("output").asString();
+	else
+		outputFile = "sweep.csv";
+
+	Json::Value progs = msg.getValue("programs");
+	if (!progs.isArray() || progs.size() == 0) {
+		printf("Error: %s: programs is not a list of program files\n",
+				filename);
+		return false;
+	}
+	//a program that can't be loaded is reported once, not by every run
+	FILE* out = fopen("/dev/null", "w");
+	if (out == NULL)
+		return false;
+	bool ok = true;
+	for (uint32_t i = 0; ok && i < progs.size(); i++) {
+		programNames.push_back(progs[i].asString());
+		Simulator* simulator = new Simulator(&baseInfo, out);
+		ok = loadProgram(simulator, programNames[i].c_str());
+		delete simulator;
+	}
+	fclose(out);
+	if (!ok)
+		return false;
+
+	Json::Value params = msg.getValue("params");
+	std::vector<std::string> names = params.getMemberNames();
+	for (uint32_t i = 0; i < names.size(); i++) {
+		Json::Value values = params[names[i]];
+		MemHrchyInfo check;
+		if (!setMemHrchyParam(&check, names[i], 0)) {
+			printf("Error: %s: unknown parameter %s\n", filename,
+					names[i].c_str());
+			return false;
+		}
+		if (!warmup.empty() && names[i] != "access_delay_l1"
+				&& names[i] != "access_delay_l2" && names[i] != "memDelay") {
+			printf("Error: %s: only the delays can be swept after a warm-up, "
+					"not %s\n", filename, names[i].c_str());
+			return false;
+		}
+		if (!values.isArray() || values.size() == 0) {
+			printf("Error: %s: %s is not a list of values\n", filename,
+					names[i].c_str());
+			return false;
+		}
+		paramNames.push_back(names[i]);
+		paramValues.push_back(std::vector<int64_t>());
+		for (uint32_t j = 0; j < values.size(); j++)
+			paramValues.back().push_back(
+					values[j].isBool() ? values[j].asBool() : values[j].asInt64());
+	}
+	return true;
+}
+
+uint64_t Sweep::numCombinations() {
+	uint64_t n = 1;
+	for (uint32_t i = 0; i < paramValues.size(); i++)
+		n *= paramValues[i].size();
+	return n;
+}
+
+void Sweep::getCombination(uint64_t combination, MemHrchyInfo* info,
+		std::vector<int64_t>& values) {
+	*info = baseInfo;
+	values.clear();
+	//mixed-radix digits of combination, the last parameter changes fastest
+	for (int i = paramValues.size() - 1; i >= 0; i--) {
+		int64_t value = paramValues[i][combination % paramValues[i].size()];
+		combination /= paramValues[i].size();
+		setMemHrchyParam(info, paramNames[i], value);
+		values.insert(values.begin(), value);
+	}
+}
+
+void Sweep::getStats(Simulator* simulator, Result* result) {
+	result->cycles = simulator->pipe->stat_cycles;
+	result->instructions = simulator->pipe->stat_inst_retire;
+	result->flushes = simulator->pipe->stat_squash;
+	result->l1iHits = simulator->l1ICache->stat_hits;
+	result->l1iMisses = simulator->l1ICache->stat_misses;
+	result->l1dHits = simulator->l1DCache->stat_hits;
+	result->l1dMisses = simulator->l1DCache->stat_misses;
+	result->l2Hits = simulator->l2Cache->stat_hits;
+	result->l2Misses = simulator->l2Cache->stat_misses;
+	result->done = true;
+}
+
+bool Sweep::simulate(uint32_t program, uint64_t combination, Result* result) {
+	MemHrchyInfo info;
+	std::vector<int64_t> values;
+	getCombination(combination, &info, values);
+
+	//the sweep only reports the statistics
+	FILE* out = fopen("/dev/null", "w");
+	FILE* in = fmemopen((void*) commands.data(), commands.size(), "r");
+	if (out == NULL || in == NULL)
+		return false;
+
+	Simulator* simulator = new Simulator(&info, out);
+	bool ok = loadProgram(simulator, programNames[program].c_str());
+	simulator->pipe->RUN_BIT = true;
+	while (ok && getCommand(simulator, in))
+		;
+
+	getStats(simulator, result);
+	ok = ok && !simulator->failed;
+	//the CSV has no row for a failed run
+	result->done = ok;
+
+	delete simulator;
+	fclose(in);
+	fclose(out);
+	return ok;
+}
+
+uint32_t Sweep::forkVariants(uint32_t program, uint32_t maxChildren) {
+	uint64_t combinations = numCombinations();
+	MemHrchyInfo info = baseInfo;
+	FILE* out = fopen("/dev/null", "w");
+	FILE* in = fmemopen((void*) warmup.data(), warmup.size(), "r");
+	if (out == NULL || in == NULL)
+		return combinations;
+
+	//the shared warm-up
+	Simulator* simulator = new Simulator(&info, out);
+	if (!loadProgram(simulator, programNames[program].c_str())) {
+		delete simulator;
+		fclose(in);
+		fclose(out);
+		return combinations;
+	}
+	simulator->pipe->RUN_BIT = true;
+	while (getCommand(simulator, in))
+		;
+	fclose(in);
+	//nothing may be in flight when the delays change
+	simulator->drainPipeline(true);
+	Result warm;
+	getStats(simulator, &warm);
+
+	//buffered output would be written by every child
+	fflush(NULL);
+
+	uint32_t failed = 0;
+	//read end of the result pipe and result index of each live child
+	std::map<pid_t, std::pair<int, uint64_t>> children;
+	for (uint64_t c = 0; c < combinations || !children.empty();) {
+		if (c < combinations && children.size() < maxChildren) {
+			int fds[2];
+			if (pipe(fds) != 0) {
+				failed += combinations - c;
+				c = combinations;
+				continue;
+			}
+			pid_t pid = fork();
+			if (pid == 0) {
+				//child: the warm state is shared copy-on-write
+				close(fds[0]);
+				std::vector<int64_t> values;
+				getCombination(c, &info, values);
+				simulator->setAccessDelays(info.access_delay_l1,
+						info.access_delay_l2, info.memDelay);
+				in = fmemopen((void*) commands.data(), commands.size(), "r");
+				while (in && getCommand(simulator, in))
+					;
+				Result result;
+				getStats(simulator, &result);
+				result.cycles -= warm.cycles;
+				result.instructions -= warm.instructions;
+				result.flushes -= warm.flushes;
+				result.l1iHits -= warm.l1iHits;
+				result.l1iMisses -= warm.l1iMisses;
+				result.l1dHits -= warm.l1dHits;
+				result.l1dMisses -= warm.l1dMisses;
+				result.l2Hits -= warm.l2Hits;
+				result.l2Misses -= warm.l2Misses;
+				bool ok = !simulator->failed
+						&& write(fds[1], &result, sizeof(result)) == sizeof(result);
+				_exit(ok ? 0 : 1);
+			}
+			close(fds[1]);
+			if (pid < 0) {
+				close(fds[0]);
+				failed++;
+			} else {
+				children[pid] = std::make_pair(fds[0], c);
+			}
+			c++;
+			continue;
+		}
+
+		//wait for a child to finish and collect its result
+		int status;
+		pid_t pid = wait(&status);
+		if (pid < 0 || children.count(pid) == 0)
+			continue;
+		int fd = children[pid].first;
+		Result* result = &results[program * combinations
+				+ children[pid].second];
+		children.erase(pid);
+		if (read(fd, result, sizeof(Result)) != sizeof(Result)
+				|| !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			result->done = false;
+			failed++;
+		}
+		close(fd);
+	}
+
+	delete simulator;
+	fclose(out);
+	return failed;
+}
+
+bool Sweep::writeCSV() {
+	FILE* csv = fopen(outputFile.c_str(), "w");
+	if (csv == NULL) {
+		printf("Error: Can't create output file %s\n", outputFile.c_str());
+		return false;
+	}
+
+	fprintf(csv, "program");
+	for (uint32_t i = 0; i < paramNames.size(); i++)
+		fprintf(csv, ",%s", paramNames[i].c_str());
+	fprintf(csv, ",cycles,instructions,ipc,flushes,l1i_hits,l1i_misses,"
+			"l1d_hits,l1d_misses,l2_hits,l2_misses\n");
+
+	uint64_t combinations = numCombinations();
+	for (uint32_t p = 0; p < programNames.size(); p++) {
+		for (uint64_t c = 0; c < combinations; c++) {
+			Result& r = results[p * combinations + c];
+			if (!r.done)
+				continue;
+			MemHrchyInfo info;
+			std::vector<int64_t> values;
+			getCombination(c, &info, values);
+
+			fprintf(csv, "%s", programNames[p].c_str());
+			for (uint32_t i = 0; i < values.size(); i++)
+				fprintf(csv, ",%ld", values[i]);
+			fprintf(csv, ",%u,%u,%0.3f,%u,%lu,%lu,%lu,%lu,%lu,%lu\n", r.cycles,
+					r.instructions, (float) r.instructions / r.cycles,
+					r.flushes, r.l1iHits, r.l1iMisses, r.l1dHits, r.l1dMisses,
+					r.l2Hits, r.l2Misses);
+		}
+	}
+	return fclose(csv) == 0;
+}
+
+uint32_t Sweep::run(uint32_t numThreads) {
+	uint64_t combinations = numCombinations();
+	results.assign(programNames.size() * combinations, Result());
+	uint32_t failed = 0;
+
+	if (!warmup.empty()) {
+		if (numThreads == 0)
+			numThreads = sysconf(_SC_NPROCESSORS_ONLN);
+		printf("Sweeping %lu runs from warm snapshots...\n\n",
+				(uint64_t) results.size());
+		for (uint32_t p = 0; p < programNames.size(); p++)
+			failed += forkVariants(p, numThreads > 0 ? numThreads : 1);
+		if (!writeCSV())
+			failed++;
+		return failed;
+	}
+
+	BatchRunner runner(numThreads);
+	for (uint32_t p = 0; p < programNames.size(); p++) {
+		for (uint64_t c = 0; c < combinations; c++) {
+			//each run writes only its own result
+			Result* result = &results[p * combinations + c];
+			result->done = false;
+			runner.addTask([this, p, c, result]() {
+				return simulate(p, c, result);
+			});
+		}
+	}
+	printf("Sweeping %lu runs...\n\n", (uint64_t) results.size());
+	failed = runner.run();
+
+	if (!writeCSV())
+		failed++;
+	return failed;
+}
@@ -0,0 +1,90 @@
+/*
+ * Computer Architecture CSE530
+ * MIPS pipeline cycle-accurate simulator
+ * PSU
+ */
+
+#ifndef __SWEEP_H__
+#define __SWEEP_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "util.h"
+#include "simulator.h"
+
+/*
+ * Design-space sweep. A sweep file (JSON) names a base config, the
+ * programs, the commands to run and a list of values per config
+ * parameter:
+ *
+ * {
+ *   "config": "config.json",
+ *   "programs": ["inputs/long/primes.x"],
+ *   "commands": "go",
+ *   "output": "sweep.csv",
+ *   "params": { "cache_size_l1": [16384, 32768], "memDelay": [40, 100] }
+ * }
+ *
+ * Every combination of the values is simulated on every program on a
+ * BatchRunner pool, and one CSV row per run is written to output.
+ * The config is parsed once and shared read-only by the runs, each
+ * run loads its program (hex, ELF or memory image) with loadProgram.
+ *
+ * If the sweep file has "warmup" commands, only the timing parameters
+ * (access_delay_l1, access_delay_l2 and memDelay) can be swept. The
+ * warm-up then runs once per program, and a fork()ed child per
+ * combination applies its delays and runs "commands" on the
+ * copy-on-write warm state. The statistics cover the commands after
+ * the warm-up only
+ */
+class Sweep {
+public:
+	Sweep();
+	virtual ~Sweep();
+
+	//parse the sweep file, its base config and its programs
+	bool readSweepFile(const char* filename);
+
+	/*
+	 * simulate all the runs and write the CSV. Returns the number of
+	 * runs that failed
+	 */
+	uint32_t run(uint32_t numThreads);
+
+private:
+	//statistics of one run
+	struct Result {
+		bool done;
+		uint32_t cycles;
+		uint32_t instructions;
+		uint32_t flushes;
+		uint64_t l1iHits, l1iMisses;
+		uint64_t l1dHits, l1dMisses;
+		uint64_t l2Hits, l2Misses;
+	};
+
+	MemHrchyInfo baseInfo;
+	std::string warmup;
+	std::string commands;
+	std::string outputFile;
+
+	std::vector<std::string> programNames;
+
+	std::vector<std::string> paramNames;
+	std::vector<std::vector<int64_t>> paramValues;
+
+	std::vector<Result> results;
+
+	uint64_t numCombinations();
+	//config of the given combination of parameter values
+	void getCombination(uint64_t combination, MemHrchyInfo* info,
+			std::vector<int64_t>& values);
+	void getStats(Simulator* simulator, Result* result);
+	bool simulate(uint32_t program, uint64_t combination, Result* result);
+	//run the combinations of a program on children of a warm simulator
+	uint32_t forkVariants(uint32_t program, uint32_t maxChildren);
+	bool writeCSV();
+};
+
+#endif
@@ -0,0 +1,116 @@
+/*
+ * Computer Architecture CSE530
+ * MIPS pipeline cycle-accurate simulator
+ * PSU
+ */
+
+#ifndef __TAG_LOOKUP_H__
+#define __TAG_LOOKUP_H__
+
+#include <cstdint>
+
+/*
+ * Kernels that search the tags of one cache set. tags points to the
+ * associativity tags of the set and valid holds one bit per way. They
+ * return the lowest valid way whose tag matches, or -1.
+ *
+ * The vector kernels load whole vectors, so they may read up to
+ * TAG_LOOKUP_PAD tags past the end of the set; tag arrays must be
+ * padded accordingly. Lanes past the set are dropped by the valid mask.
+ *
+ * Build with -DNO_SIMD_TAG_LOOKUP to always use the scalar kernel.
+ * Otherwise the AVX2 kernel is used if the host supports it, then
+ * SSE2, chosen at run time by selectTagLookup
+ */
+
+//tags the vector kernels may read past the end of a set
+#define TAG_LOOKUP_PAD 8
+
+typedef int (*TagLookupFn)(const uint32_t* tags, uint64_t valid, uint32_t tag,
+		uint32_t associativity);
+
+static inline int findTagScalar(const uint32_t* tags, uint64_t valid,
+		uint32_t tag, uint32_t associativity) {
+	//only visit the valid ways
+	for (; valid; valid &= valid - 1) {
+		int i = __builtin_ctzll(valid);
+		if (tags[i] == tag)
+			return i;
+	}
+	return -1;
+}
+
+#if !defined(NO_SIMD_TAG_LOOKUP) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_SIMD_TAG_LOOKUP
+#include <immintrin.h>
+
+/*
+ * The vector kernels are instantiated for the associativities of the
+ * common configurations (Assoc), so that their way loop is fully
+ * unrolled. Assoc = 0 is the generic kernel for any associativity
+ */
+template<uint32_t Assoc>
+__attribute__((target("sse2")))
+static inline int findTagSSE2(const uint32_t* tags, uint64_t valid,
+		uint32_t tag, uint32_t associativity) {
+	const uint32_t ways = Assoc ? Assoc : associativity;
+	__m128i key = _mm_set1_epi32(tag);
+	uint64_t match = 0;
+	for (uint32_t i = 0; i < ways; i += 4) {
+		__m128i t = _mm_loadu_si128((const __m128i*) (tags + i));
+		uint32_t m = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(t, key)));
+		match |= (uint64_t) m << i;
+	}
+	match &= valid;
+	return match ? __builtin_ctzll(match) : -1;
+}
+
+template<uint32_t Assoc>
+__attribute__((target("avx2")))
+static inline int findTagAVX2(const uint32_t* tags, uint64_t valid,
+		uint32_t tag, uint32_t associativity) {
+	const uint32_t ways = Assoc ? Assoc : associativity;
+	__m256i key = _mm256_set1_epi32(tag);
+	uint64_t match = 0;
+	for (uint32_t i = 0; i < ways; i += 8) {
+		__m256i t = _mm256_loadu_si256((const __m256i*) (tags + i));
+		uint32_t m = _mm256_movemask_ps(
+				_mm256_castsi256_ps(_mm256_cmpeq_epi32(t, key)));
+		match |= (uint64_t) m << i;
+	}
+	match &= valid;
+	return match ? __builtin_ctzll(match) : -1;
+}
+#endif
+
+//the fastest kernel the host supports for the given associativity
+static inline TagLookupFn selectTagLookup(uint32_t associativity) {
+#ifdef HAVE_SIMD_TAG_LOOKUP
+	//one SSE2 vector already covers 4 ways
+	if (associativity > 4 && __builtin_cpu_supports("avx2")) {
+		switch (associativity) {
+		case 8:
+			return findTagAVX2<8>;
+		case 16:
+			return findTagAVX2<16>;
+		default:
+			return findTagAVX2<0>;
+		}
+	}
+	if (__builtin_cpu_supports("sse2")) {
+		switch (associativity) {
+		case 4:
+			return findTagSSE2<4>;
+		case 8:
+			return findTagSSE2<8>;
+		case 16:
+			return findTagSSE2<16>;
+		default:
+			return findTagSSE2<0>;
+		}
+	}
+#endif
+	return findTagScalar;
+}
+
+#endif
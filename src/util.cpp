@@ -6,10 +6,27 @@
 
 #include "util.h"
 
-bool DEBUG_MEMORY = false;
-bool DEBUG_PIPE = false;
-bool DEBUG_CACHE = false;
-bool DEBUG_PREFETCH = false;
-bool DEBUG_ALL = false;
+RandomGenerator::RandomGenerator(uint32_t seed) {
+	//same initialization as glibc's srandom()
+	state[0] = seed;
+	for (int i = 1; i < 31; i++) {
+		int64_t val = (16807LL * (int32_t) state[i - 1]) % 2147483647;
+		if (val < 0)
+			val += 2147483647;
+		state[i] = val;
+	}
+	for (int i = 31; i < 34; i++)
+		state[i] = state[i - 31];
+	index = 0;
+	//glibc discards the first 310 values
+	for (int i = 34; i < 344; i++)
+		next();
+}
 
-bool TRACE_MEMORY = false;
+uint32_t RandomGenerator::next() {
+	//r[i] = r[i-31] + r[i-3]
+	uint32_t val = state[(index + 3) % 34] + state[(index + 31) % 34];
+	state[index] = val;
+	index = (index + 1) % 34;
+	return val >> 1;
+}
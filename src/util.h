@@ -7,23 +7,77 @@
 #ifndef __UTIL_H__
 #define __UTIL_H__
 #include <cstdint>
+#include <cstdio>
 
-uint64_t extern currCycle;
-
-extern bool DEBUG_MEMORY;
-extern bool DEBUG_PIPE;
-extern bool DEBUG_CACHE;
-extern bool DEBUG_PREFETCH;
-
-extern bool TRACE_MEMORY;
+class PacketPool;
 
+/*
+ * Prints a debug message with the clock of the simulator. Must be
+ * used where the SimContext of the simulator is in scope as ctx
+ */
 #define DPRINTF(flag, fmt, ...) \
-	if(flag) \
-        fprintf(stdout, "Cycle %9lu : [%s][%s]%d: " fmt, currCycle, __FILE__, __func__, __LINE__, ##__VA_ARGS__);
+	if(ctx->flag) \
+        fprintf(ctx->out, "Cycle %9lu : [%s][%s]%d: " fmt, ctx->currCycle, __FILE__, __func__, __LINE__, ##__VA_ARGS__);
 
 #define TRACE(flag, cond, fmt, ...) \
-	if((flag) && (cond)) \
-        fprintf(stdout, fmt, ##__VA_ARGS__);
+	if((ctx->flag) && (cond)) \
+        fprintf(ctx->out, fmt, ##__VA_ARGS__);
+
+/*
+ * Pseudo-random number generator of the replacement policies. It
+ * produces the same sequence as glibc's rand() with the default seed
+ * (an additive feedback generator) but keeps its state in the object,
+ * so that the state can be checkpointed
+ */
+class RandomGenerator {
+public:
+	RandomGenerator(uint32_t seed = 1);
+	//returns a number in [0, 2^31)
+	uint32_t next();
+
+	//the last 34 values of the feedback sequence
+	uint32_t state[34];
+	uint32_t index;
+};
+
+/*
+ * State shared by all the objects of one simulator instance. Nothing
+ * in the simulator is global, so several instances can run
+ * concurrently in one process
+ */
+class SimContext {
+public:
+	SimContext(FILE* out = stdout) :
+			currCycle(0), DEBUG_MEMORY(false), DEBUG_PIPE(false), DEBUG_CACHE(
+					false), DEBUG_PREFETCH(false), TRACE_MEMORY(false), out(
+					out), packets(nullptr), staticHierarchy(false) {
+	}
+
+	//global clock of the simulator
+	uint64_t currCycle;
+
+	bool DEBUG_MEMORY;
+	bool DEBUG_PIPE;
+	bool DEBUG_CACHE;
+	bool DEBUG_PREFETCH;
+
+	bool TRACE_MEMORY;
+
+	//where the simulator prints its results and debug messages
+	FILE* out;
+
+	//allocator of all the memory packets, owned by the Simulator
+	PacketPool* packets;
+
+	/*
+	 * the objects are wired in the standard topology (core -> L1I/L1D
+	 * -> L2 -> main memory), so the memory objects can call their
+	 * neighbours through their concrete types instead of virtually
+	 */
+	bool staticHierarchy;
+
+	RandomGenerator random;
+};
 
 enum ReplacementPolicy{
 	RandomReplPolicy,
@@ -54,6 +108,25 @@ public:
 	uint64_t access_delay_l1;
 	uint32_t access_delay_l2;
 	uint32_t memDelay;
+	//max number of requests a level has in flight before it rejects more
+	uint32_t req_queue_size_l1;
+	uint32_t req_queue_size_l2;
+	uint32_t req_queue_size_mem;
+	//dynamic branch predictor
+	uint32_t bht_entries;
+	uint32_t bht_entry_width;
+	uint32_t pht_width;
+	uint32_t btb_size;
+	//fast-forward over cycles in which only memory latency elapses
+	bool skipIdleCycles;
+	//caches keep only tags, data is read from the main memory
+	bool cacheTagOnly;
+	//debug flags of the simulator
+	bool debugMemory;
+	bool debugPipe;
+	bool debugCache;
+	bool debugPrefetch;
+	bool traceMemory;
 
 	MemHrchyInfo() {
 		cache_size_l1 = 32768;
@@ -67,6 +140,17 @@ public:
 		access_delay_l1 = 2;
 		access_delay_l2 = 20;
 		memDelay = 100;
+		req_queue_size_l1 = 100;
+		req_queue_size_l2 = 100;
+		req_queue_size_mem = 100;
+		bht_entries = 2048;
+		bht_entry_width = 8;
+		pht_width = 2;
+		btb_size = 1024;
+		skipIdleCycles = true;
+		cacheTagOnly = false;
+		debugMemory = debugPipe = debugCache = debugPrefetch = false;
+		traceMemory = false;
 	}
 };
 
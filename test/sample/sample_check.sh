@@ -0,0 +1,47 @@
+#!/bin/bash
+#
+# Regression check of sampled simulation: for every program, "sample"
+# must leave the same registers and memory as "go" (the statistics
+# differ by design). Run from the repository root after make:
+#
+#   test/sample/sample_check.sh [config.json] [inputs/*/*.x]
+#
+
+sim=./simulator
+config=${1:-config.json}
+shift
+inputs=${@:-inputs/*/*.x}
+samplings=("sample 50 10 10" "sample 5000 500 300")
+
+#architectural state in the rdump and memDump output
+state() {
+	grep -E '^(HI:|LO:|R[0-9]+:|PC:|MEM\[)'
+}
+
+#commands of program $1 with the run command $2
+commands() {
+	base=${1%.x}
+	[ -f $base.cmd ] && cat $base.cmd
+	printf "\n$2\nrdump\n"
+	[ -f $base.mem ] && cat $base.mem
+	printf "quit\n"
+}
+
+errors=0
+for i in $inputs; do
+	ref=$(commands $i "go" | $sim $config $i 2>/dev/null | state)
+	for s in "${samplings[@]}"; do
+		out=$(commands $i "$s" | $sim $config $i 2>/dev/null | state)
+		if [ "$ref" != "$out" ]; then
+			echo "ERROR -- $i: '$s' and 'go' end in different states"
+			diff <(echo "$ref") <(echo "$out") | head -5
+			errors=$((errors + 1))
+		fi
+	done
+done
+
+if [ $errors -eq 0 ]; then
+	echo "SAMPLE AND GO STATES OK"
+	exit 0
+fi
+exit 1
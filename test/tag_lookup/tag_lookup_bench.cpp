@@ -0,0 +1,101 @@
+/*
+ * Computer Architecture CSE530
+ * MIPS pipeline cycle-accurate simulator
+ * PSU
+ */
+
+/*
+ * Microbenchmark of the cache tag lookup kernels (src/tag_lookup.h).
+ * Checks that every kernel agrees with the scalar one, then prints the
+ * time per lookup at 4, 8, 16 and 32 ways. From the repository root:
+ *
+ *   g++ -std=c++11 -O2 -I . test/tag_lookup/tag_lookup_bench.cpp -o tag_bench
+ *   ./tag_bench
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+
+#include "src/tag_lookup.h"
+
+#define NUM_SETS 4096
+#define NUM_LOOKUPS (1 << 24)
+
+struct Kernel {
+	const char* name;
+	TagLookupFn fn;
+};
+
+int main(int argc, char** argv) {
+	std::vector<Kernel> kernels;
+	kernels.push_back(Kernel { "scalar", findTagScalar });
+#ifdef HAVE_SIMD_TAG_LOOKUP
+	if (__builtin_cpu_supports("sse2"))
+		kernels.push_back(Kernel { "sse2", findTagSSE2<0> });
+	if (__builtin_cpu_supports("avx2"))
+		kernels.push_back(Kernel { "avx2", findTagAVX2<0> });
+#endif
+	//the kernel a Cache of the given associativity uses
+	kernels.push_back(Kernel { "selected", nullptr });
+
+	uint32_t ways[] = { 4, 8, 16, 32 };
+	printf("%6s", "ways");
+	for (uint32_t k = 0; k < kernels.size(); k++)
+		printf(" %10s", kernels[k].name);
+	printf("  (ns per lookup)\n");
+
+	srand(1);
+	for (uint32_t w = 0; w < 4; w++) {
+		uint32_t assoc = ways[w];
+		std::vector<uint32_t> tags(NUM_SETS * assoc + TAG_LOOKUP_PAD);
+		std::vector<uint64_t> valid(NUM_SETS);
+		for (uint32_t i = 0; i < tags.size(); i++)
+			tags[i] = rand() % (assoc * 2);
+		//most ways valid, like a warm cache
+		for (uint32_t s = 0; s < NUM_SETS; s++)
+			for (uint32_t i = 0; i < assoc; i++)
+				if (rand() % 8)
+					valid[s] |= (uint64_t) 1 << i;
+
+		//about half of the lookups hit
+		std::vector<uint32_t> sets(NUM_LOOKUPS), keys(NUM_LOOKUPS);
+		for (uint32_t i = 0; i < NUM_LOOKUPS; i++) {
+			sets[i] = rand() % NUM_SETS;
+			keys[i] = rand() % (assoc * 2);
+		}
+
+		printf("%6u", assoc);
+		for (uint32_t k = 0; k < kernels.size(); k++) {
+			TagLookupFn fn = kernels[k].fn ? kernels[k].fn : selectTagLookup(assoc);
+			auto start = std::chrono::steady_clock::now();
+			int64_t sum = 0;
+			for (uint32_t i = 0; i < NUM_LOOKUPS; i++) {
+				uint32_t s = sets[i];
+				sum += fn(&tags[s * assoc], valid[s], keys[i], assoc);
+			}
+			auto end = std::chrono::steady_clock::now();
+
+			//same answers as the scalar kernel
+			for (uint32_t i = 0; i < NUM_LOOKUPS; i += 97) {
+				uint32_t s = sets[i];
+				if (fn(&tags[s * assoc], valid[s], keys[i], assoc)
+						!= findTagScalar(&tags[s * assoc], valid[s], keys[i],
+								assoc)) {
+					printf("\n%s kernel disagrees with the scalar one\n",
+							kernels[k].name);
+					return 1;
+				}
+			}
+
+			double ns = std::chrono::duration<double, std::nano>(end - start).count();
+			printf(" %10.2f", ns / NUM_LOOKUPS);
+			//keep the lookups from being optimized away
+			if (sum == 1)
+				printf("!");
+		}
+		printf("\n");
+	}
+	return 0;
+}